@@ -0,0 +1,411 @@
+// measures flow control auto-tuning over a loopback link with added delay.
+// a relay between client and server holds every packet for half the round
+// trip. one bulk connection uploads a payload while light connections
+// bounce small messages alongside it. each run is done with small fixed
+// windows, small windows that auto-tune, and large fixed windows. lsquic
+// doesn't report its current windows, so the bulk connection's window is
+// estimated from throughput times the round trip. the light connections
+// never fill their small windows, so only the bulk connection grows its
+// window. the server charges every connection the larger of its initial
+// and maximum window whether it grows or not (see settings::memory_budget)
+//
+// usage: bench_flow_control [megabytes] [rtt in ms] [light connections]
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "global/global_init.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_server.h"
+#include "quic/quic_stream.h"
+
+#include "certificate.h"
+
+namespace
+{
+
+	using clock_type = std::chrono::steady_clock;
+
+	size_t parse_arg(int argc, char** argv, int index, size_t default_value)
+	{
+		if (argc <= index)
+		{
+			return default_value;
+		}
+		const auto begin = argv[index];
+		const auto end = begin + ::strlen(begin);
+		size_t value = 0;
+		const auto result = std::from_chars(begin, end, value);
+		if (auto ec = std::make_error_code(result.ec); ec)
+		{
+			std::cerr << "failed to parse \"" << begin << "\": " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+		return value;
+	}
+
+	void check(error_code ec, const char* what)
+	{
+		if (ec)
+		{
+			std::cerr << what << " failed with " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+	}
+
+	// forwards datagrams between one client and the server, delaying each by
+	// a fixed amount. packets that don't fit in the socket buffers are lost
+	class delayed_link
+	{
+		struct packet
+		{
+			clock_type::time_point due;
+			udp::endpoint to;
+			std::vector<char> data;
+		};
+
+		udp::socket socket;
+		boost::asio::steady_timer timer;
+		udp::endpoint server;
+		udp::endpoint client;
+		udp::endpoint from;
+		std::array<char, 65536> buffer;
+		std::deque<packet> queue; // in order of due time
+		clock_type::duration delay;
+		bool armed = false;
+
+		void receive()
+		{
+			socket.async_receive_from(boost::asio::buffer(buffer), from,
+				[this](error_code ec, size_t bytes)
+				{ on_receive(ec, bytes); });
+		}
+
+		void on_receive(error_code ec, size_t bytes)
+		{
+			if (ec == boost::asio::error::operation_aborted)
+			{
+				return;
+			}
+			if (!ec)
+			{
+				if (from != server)
+				{
+					client = from;
+				}
+				const auto& to = from == server ? client : server;
+				queue.push_back({ clock_type::now() + delay, to,
+								  std::vector<char>(buffer.data(), buffer.data() + bytes) });
+				if (!armed)
+				{
+					arm();
+				}
+			}
+			receive();
+		}
+
+		void arm()
+		{
+			armed = true;
+			timer.expires_at(queue.front().due);
+			timer.async_wait([this](error_code ec)
+			{ on_timer(ec); });
+		}
+
+		void on_timer(error_code ec)
+		{
+			armed = false;
+			if (ec)
+			{
+				return;
+			}
+			const auto now = clock_type::now();
+			while (!queue.empty() && queue.front().due <= now)
+			{
+				auto& p = queue.front();
+				error_code ignored;
+				socket.send_to(boost::asio::buffer(p.data), p.to, 0, ignored);
+				queue.pop_front();
+			}
+			if (!queue.empty())
+			{
+				arm();
+			}
+		}
+
+	public:
+		delayed_link(const boost::asio::any_io_executor& ex,
+			const udp::endpoint& server, clock_type::duration delay)
+			: socket(ex, udp::endpoint{ server.address(), 0 }),
+			  timer(ex),
+			  server(server),
+			  delay(delay)
+		{
+			error_code ignored;
+			socket.set_option(udp::socket::receive_buffer_size(8 * 1024 * 1024), ignored);
+			socket.set_option(udp::socket::send_buffer_size(8 * 1024 * 1024), ignored);
+			socket.non_blocking(true);
+			receive();
+		}
+
+		udp::endpoint local_endpoint() const
+		{
+			return socket.local_endpoint();
+		}
+
+		void close()
+		{
+			error_code ignored;
+			socket.close(ignored);
+			timer.cancel();
+		}
+	};
+
+	struct window_config
+	{
+		const char* name;
+		uint32_t window;
+		uint32_t max_window; // 0 disables auto-tuning
+	};
+
+	quic::settings bench_settings(quic::settings s, const window_config& config)
+	{
+		s.connection_flow_control_window = config.window;
+		s.incoming_stream_flow_control_window = config.window;
+		s.outgoing_stream_flow_control_window = config.window;
+		s.max_connection_flow_control_window = config.max_window;
+		s.max_stream_flow_control_window = config.max_window;
+		return s;
+	}
+
+	constexpr size_t light_message = 1024;
+
+	// a connection with one stream. the first byte sent on the stream tells
+	// the server whether it's the bulk upload or a light connection to echo
+	struct peer
+	{
+		quic::connection conn;
+		quic::stream stream;
+		std::vector<char> buffer;
+		size_t round_trips = 0;
+
+		peer(quic::client& client, const udp::endpoint& endpoint)
+			: conn(client, endpoint, "host"), stream(conn)
+		{
+		}
+
+		explicit peer(quic::acceptor& acceptor)
+			: conn(acceptor), stream(conn), buffer(65536)
+		{
+		}
+	};
+
+	void run(const window_config& config, size_t payload_bytes,
+		clock_type::duration rtt, size_t lights)
+	{
+		auto context = boost::asio::io_context{};
+		auto ex = context.get_executor();
+
+		const char* alpn = "\05bench";
+		auto ssl = test::init_server_context(alpn);
+		auto sslc = test::init_client_context(alpn);
+
+		auto server = quic::server{ ex, bench_settings(quic::default_server_settings(), config) };
+		const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+		auto acceptor = quic::acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+		acceptor.listen(static_cast<int>(lights + 1));
+
+		auto link = delayed_link{ ex, acceptor.local_endpoint(), rtt / 2 };
+		auto client = quic::client{ ex, udp::endpoint{}, sslc,
+			bench_settings(quic::default_client_settings(), config) };
+
+		// server: drain the bulk upload, echo the light connections
+		bool done = false;
+		size_t received = 0;
+		clock_type::time_point finish;
+		auto servers = std::vector<std::unique_ptr<peer>>{};
+		std::function<void(peer&)> drain = [&](peer& p)
+		{
+			p.stream.async_read_some(boost::asio::buffer(p.buffer), [&](error_code ec, size_t bytes)
+			{
+				received += bytes;
+				if (ec || !bytes)
+				{
+					finish = clock_type::now();
+					done = true;
+					return;
+				}
+				drain(p);
+			});
+		};
+		std::function<void(peer&, size_t)> echo = [&](peer& p, size_t bytes)
+		{
+			p.stream.async_write_all(boost::asio::buffer(p.buffer.data(), bytes),
+				[&](error_code ec, size_t)
+				{
+					if (ec)
+					{
+						return;
+					}
+					p.stream.async_read_some(boost::asio::buffer(p.buffer), [&](error_code ec, size_t bytes)
+					{
+						if (!ec && bytes)
+						{
+							echo(p, bytes);
+						}
+					});
+				});
+		};
+		std::function<void()> accept = [&]
+		{
+			auto& p = *servers.emplace_back(std::make_unique<peer>(acceptor));
+			acceptor.async_accept(p.conn, [&](error_code ec)
+			{
+				check(ec, "accept");
+				p.conn.async_accept(p.stream, [&](error_code ec)
+				{
+					check(ec, "stream accept");
+					p.stream.async_read_some(boost::asio::buffer(p.buffer.data(), 1),
+						[&](error_code ec, size_t)
+						{
+							check(ec, "first read");
+							if (p.buffer[0] == 'b')
+							{
+								received++;
+								drain(p);
+							}
+							else
+							{
+								echo(p, 1);
+							}
+						});
+				});
+				if (servers.size() < lights + 1)
+				{
+					accept();
+				}
+			});
+		};
+		accept();
+
+		// client: upload the payload on one connection, bounce messages on the rest
+		auto payload = std::vector<char>(256 * 1024, 'b');
+		size_t sent = 0;
+		clock_type::time_point start;
+		auto bulk = peer{ client, link.local_endpoint() };
+		std::function<void(error_code, size_t)> upload = [&](error_code ec, size_t bytes)
+		{
+			check(ec, "bulk write");
+			sent += bytes;
+			if (sent == payload_bytes)
+			{
+				bulk.stream.shutdown(1);
+				return;
+			}
+			const size_t n = std::min(payload.size(), payload_bytes - sent);
+			bulk.stream.async_write_all(boost::asio::buffer(payload.data(), n), upload);
+		};
+		bulk.conn.async_connect(bulk.stream, [&](error_code ec)
+		{
+			check(ec, "bulk connect");
+			start = clock_type::now();
+			upload(error_code{}, 0);
+		});
+
+		auto clients = std::vector<std::unique_ptr<peer>>{};
+		std::function<void(peer&)> bounce = [&](peer& p)
+		{
+			p.stream.async_write_all(boost::asio::buffer(p.buffer), [&](error_code ec, size_t)
+			{
+				check(ec, "light write");
+				p.stream.async_read(boost::asio::buffer(p.buffer), [&](error_code ec, size_t)
+				{
+					check(ec, "light read");
+					p.buffer[0] = 'l';
+					p.round_trips++;
+					if (!done)
+					{
+						bounce(p);
+					}
+				});
+			});
+		};
+		for (size_t i = 0; i < lights; i++)
+		{
+			auto& p = *clients.emplace_back(std::make_unique<peer>(client, link.local_endpoint()));
+			p.buffer.assign(light_message, 'l');
+			p.conn.async_connect(p.stream, [&](error_code ec)
+			{
+				check(ec, "light connect");
+				bounce(p);
+			});
+		}
+
+		while (!done && context.run_one())
+		{
+		}
+		const auto charged = server.memory_stats().used;
+
+		const double seconds = std::chrono::duration<double>(finish - start).count();
+		const double throughput = static_cast<double>(received) / seconds;
+		const double rtt_seconds = std::chrono::duration<double>(rtt).count();
+		size_t round_trips = 0;
+		for (const auto& p : clients)
+		{
+			round_trips += p->round_trips;
+		}
+		const double light_rate = lights ? static_cast<double>(round_trips) / lights / seconds : 0;
+		std::cout << std::left << std::setw(12) << config.name << std::right << std::fixed
+				  << std::setprecision(1) << ": bulk " << throughput / (1024 * 1024)
+				  << " MiB/s, effective window " << throughput * rtt_seconds / 1024
+				  << " KiB; light " << light_rate << " round trips/s each; server charged "
+				  << charged / 1024 << " KiB\n";
+
+		bulk.conn.close();
+		for (auto& p : clients)
+		{
+			error_code ec;
+			p->conn.close(ec);
+		}
+		link.close();
+		context.poll();
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	const size_t megabytes = std::max<size_t>(1, parse_arg(argc, argv, 1, 16));
+	const auto rtt = std::chrono::milliseconds(std::max<size_t>(1, parse_arg(argc, argv, 2, 20)));
+	const size_t lights = parse_arg(argc, argv, 3, 8);
+	auto global = global::init_client_server();
+
+	constexpr uint32_t small = 64 * 1024;
+	constexpr uint32_t large = 16 * 1024 * 1024;
+	const window_config configs[] = {
+		{ "fixed small", small, 0 },
+		{ "auto-tuned", small, large },
+		{ "fixed large", large, 0 },
+	};
+	std::cout << megabytes << " MiB upload, " << rtt.count() << "ms round trip, "
+			  << lights << " light connections\n";
+	for (const auto& config : configs)
+	{
+		run(config, megabytes * 1024 * 1024, rtt, lights);
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+// measures the memory held by idle connections. establishes the given
+// number of connections over loopback, both ends in this process, and
+// reports the growth in resident memory per connection next to what
+// connection::memory_usage() accounts for. the difference is lsquic's
+// per-connection state, its TLS session and allocator overhead
+//
+// usage: bench_idle_connections [connections] [handshakes in flight]
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <unistd.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include "global/global_init.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_server.h"
+
+#include "certificate.h"
+
+namespace
+{
+
+	size_t parse_arg(int argc, char** argv, int index, size_t default_value)
+	{
+		if (argc <= index)
+		{
+			return default_value;
+		}
+		const auto begin = argv[index];
+		const auto end = begin + ::strlen(begin);
+		size_t value = 0;
+		const auto result = std::from_chars(begin, end, value);
+		if (auto ec = std::make_error_code(result.ec); ec)
+		{
+			std::cerr << "failed to parse \"" << begin << "\": " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+		return value;
+	}
+
+	size_t resident_bytes()
+	{
+		auto statm = std::ifstream{ "/proc/self/statm" };
+		size_t total = 0;
+		size_t resident = 0;
+		statm >> total >> resident;
+		return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	}
+
+	quic::settings bench_settings(quic::settings s)
+	{
+		// the first connections mustn't time out while the rest handshake
+		s.idle_timeout = std::chrono::seconds(600);
+		return s;
+	}
+
+	using connection_list = std::vector<std::unique_ptr<quic::connection>>;
+
+	size_t library_bytes(const connection_list& connections)
+	{
+		size_t bytes = 0;
+		for (const auto& c : connections)
+		{
+			bytes += c->memory_usage();
+		}
+		return bytes;
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	const size_t count = parse_arg(argc, argv, 1, 100000);
+	const size_t in_flight = std::max<size_t>(parse_arg(argc, argv, 2, 256), 1);
+
+	auto context = boost::asio::io_context{};
+	auto ex = context.get_executor();
+	auto global = global::init_client_server();
+
+	const char* alpn = "\05bench";
+	auto ssl = test::init_server_context(alpn);
+	auto sslc = test::init_client_context(alpn);
+
+	auto server = quic::server{ ex, bench_settings(quic::default_server_settings()) };
+	const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+	auto acceptor = quic::acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+	acceptor.listen(static_cast<int>(in_flight));
+	auto client = quic::client{ ex, udp::endpoint{}, sslc, bench_settings(quic::default_client_settings()) };
+
+	auto client_connections = connection_list{};
+	auto server_connections = connection_list{};
+	client_connections.reserve(count);
+	server_connections.reserve(count);
+
+	const size_t rss_before = resident_bytes();
+	const auto start = std::chrono::steady_clock::now();
+
+	size_t accepted = 0;
+	std::function<void()> accept = [&]
+	{
+		auto& conn = server_connections.emplace_back(std::make_unique<quic::connection>(acceptor));
+		acceptor.async_accept(*conn, [&](error_code ec)
+		{
+			if (ec)
+			{
+				std::cerr << "accept failed with " << ec.message() << '\n';
+				::exit(EXIT_FAILURE);
+			}
+			accepted++;
+			if (server_connections.size() < count)
+			{
+				accept();
+			}
+		});
+	};
+	accept();
+
+	while (accepted < count)
+	{
+		while (client_connections.size() < count && client_connections.size() - accepted < in_flight)
+		{
+			client_connections.push_back(std::make_unique<quic::connection>(
+				client, acceptor.local_endpoint(), "host"));
+		}
+		context.run_one();
+	}
+	context.poll();
+
+	const auto finish = std::chrono::steady_clock::now();
+	const size_t rss_after = resident_bytes();
+	const size_t connections = client_connections.size() + server_connections.size();
+	const double rss_per_connection = static_cast<double>(rss_after - rss_before) / static_cast<double>(connections);
+	const size_t library = library_bytes(client_connections) + library_bytes(server_connections);
+	const double library_per_connection = static_cast<double>(library) / static_cast<double>(connections);
+
+	std::cout << count << " connection pairs in "
+			  << std::chrono::duration<double>(finish - start).count() << "s\n"
+			  << "resident growth: " << (rss_after - rss_before) << " bytes, "
+			  << rss_per_connection << " per connection\n"
+			  << "library: " << library_per_connection << " bytes per connection\n"
+			  << "lsquic, TLS and allocator: " << (rss_per_connection - library_per_connection)
+			  << " bytes per connection\n";
+
+	for (auto& c : client_connections)
+	{
+		error_code ec;
+		c->close(ec);
+	}
+	context.poll();
+	return 0;
+}
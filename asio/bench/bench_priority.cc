@@ -0,0 +1,246 @@
+// measures round-trip latency on a small control stream while a bulk stream
+// on the same connection keeps the send path saturated. each run is done
+// once with default priorities and once with the control stream at the
+// highest priority and the bulk stream at the lowest
+//
+// usage: bench_priority [pings]
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "global/global_init.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_server.h"
+#include "quic/quic_stream.h"
+
+#include "certificate.h"
+
+namespace
+{
+
+	using clock_type = std::chrono::steady_clock;
+
+	size_t parse_arg(int argc, char** argv, int index, size_t default_value)
+	{
+		if (argc <= index)
+		{
+			return default_value;
+		}
+		const auto begin = argv[index];
+		const auto end = begin + ::strlen(begin);
+		size_t value = 0;
+		const auto result = std::from_chars(begin, end, value);
+		if (auto ec = std::make_error_code(result.ec); ec)
+		{
+			std::cerr << "failed to parse \"" << begin << "\": " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+		return value;
+	}
+
+	void check(error_code ec, const char* what)
+	{
+		if (ec)
+		{
+			std::cerr << what << " failed with " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+	}
+
+	quic::settings bench_settings()
+	{
+		auto s = quic::default_server_settings();
+		s.connection_flow_control_window = 16 * 1024 * 1024;
+		s.incoming_stream_flow_control_window = 16 * 1024 * 1024;
+		s.outgoing_stream_flow_control_window = 16 * 1024 * 1024;
+		return s;
+	}
+
+	void run(bool prioritized, size_t pings)
+	{
+		auto context = boost::asio::io_context{};
+		auto ex = context.get_executor();
+
+		const char* alpn = "\05bench";
+		auto ssl = test::init_server_context(alpn);
+		auto sslc = test::init_client_context(alpn);
+
+		auto server = quic::server{ ex, bench_settings() };
+		const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+		auto acceptor = quic::acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+		acceptor.listen(16);
+
+		auto client = quic::client{ ex, udp::endpoint{}, sslc, bench_settings() };
+		auto cconn = quic::connection{ client, acceptor.local_endpoint(), "host" };
+		auto bulk = quic::stream{ cconn };
+		auto control = quic::stream{ cconn };
+
+		// server: drain the bulk stream, echo the control stream
+		auto sconn = quic::connection{ acceptor };
+		auto sstreams = std::array<quic::stream, 2>{ quic::stream{ sconn }, quic::stream{ sconn } };
+		auto drain = std::vector<char>(65536);
+		auto echo = std::array<char, 64>{};
+		std::function<void(quic::stream&, error_code, size_t)> on_drain =
+			[&](quic::stream& s, error_code ec, size_t bytes)
+		{
+			if (!ec && bytes)
+			{
+				s.async_read_some(boost::asio::buffer(drain),
+					[&](error_code ec, size_t bytes)
+					{ on_drain(s, ec, bytes); });
+			}
+		};
+		std::function<void(quic::stream&, error_code, size_t)> on_echo =
+			[&](quic::stream& s, error_code ec, size_t bytes)
+		{
+			if (ec || !bytes)
+			{
+				return;
+			}
+			s.async_write_all(boost::asio::buffer(echo.data(), bytes),
+				[&](error_code ec, size_t)
+				{
+					check(ec, "echo");
+					s.async_read_some(boost::asio::buffer(echo),
+						[&](error_code ec, size_t bytes)
+						{ on_echo(s, ec, bytes); });
+				});
+		};
+		auto on_stream = [&](quic::stream& s)
+		{
+			if (s.id() == bulk.id())
+			{
+				on_drain(s, error_code{}, 1);
+			}
+			else
+			{
+				s.async_read_some(boost::asio::buffer(echo),
+					[&](error_code ec, size_t bytes)
+					{ on_echo(s, ec, bytes); });
+			}
+		};
+		acceptor.async_accept(sconn, [&](error_code ec)
+		{
+			check(ec, "accept");
+			for (auto& s : sstreams)
+			{
+				sconn.async_accept(s, [&](error_code ec)
+				{
+					check(ec, "stream accept");
+					on_stream(s);
+				});
+			}
+		});
+
+		// client: keep the bulk stream busy until the pings are done
+		bool done = false;
+		auto payload = std::vector<char>(256 * 1024, 'b');
+		std::function<void(error_code, size_t)> on_bulk = [&](error_code ec, size_t)
+		{
+			check(ec, "bulk write");
+			if (done)
+			{
+				bulk.shutdown(1);
+				return;
+			}
+			bulk.async_write_some(boost::asio::buffer(payload), on_bulk);
+		};
+		cconn.async_connect(bulk, [&](error_code ec)
+		{
+			check(ec, "bulk connect");
+			if (prioritized)
+			{
+				bulk.set_priority(256);
+			}
+			on_bulk(error_code{}, 0);
+		});
+
+		auto samples = std::vector<double>{};
+		samples.reserve(pings);
+		auto ping = std::array<char, 8>{};
+		auto pong = std::array<char, 8>{};
+		size_t pong_bytes = 0;
+		clock_type::time_point sent;
+		std::function<void()> send_ping;
+		std::function<void(error_code, size_t)> on_pong = [&](error_code ec, size_t bytes)
+		{
+			check(ec, "pong");
+			pong_bytes += bytes;
+			if (pong_bytes < pong.size())
+			{
+				control.async_read_some(boost::asio::buffer(pong.data() + pong_bytes,
+					pong.size() - pong_bytes), on_pong);
+				return;
+			}
+			samples.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - sent).count());
+			if (samples.size() == pings)
+			{
+				done = true;
+				control.shutdown(1);
+				return;
+			}
+			send_ping();
+		};
+		send_ping = [&]
+		{
+			sent = clock_type::now();
+			pong_bytes = 0;
+			control.async_write_all(boost::asio::buffer(ping), [&](error_code ec, size_t)
+			{
+				check(ec, "ping");
+				control.async_read_some(boost::asio::buffer(pong), on_pong);
+			});
+		};
+		cconn.async_connect(control, [&](error_code ec)
+		{
+			check(ec, "control connect");
+			if (prioritized)
+			{
+				control.set_priority(1);
+			}
+			send_ping();
+		});
+
+		while (!done && context.run_one())
+		{
+		}
+
+		std::sort(samples.begin(), samples.end());
+		double total = 0;
+		for (auto s : samples)
+		{
+			total += s;
+		}
+		const auto percentile = [&](double p)
+		{
+			return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+		};
+		std::cout << (prioritized ? "prioritized" : "default    ")
+				  << ": " << samples.size() << " pings, mean " << total / samples.size()
+				  << "us, p50 " << percentile(0.5) << "us, p99 " << percentile(0.99)
+				  << "us, max " << samples.back() << "us\n";
+
+		cconn.close();
+		context.poll();
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	const size_t pings = std::max<size_t>(1, parse_arg(argc, argv, 1, 1000));
+	auto global = global::init_client_server();
+	run(false, pings);
+	run(true, pings);
+	return 0;
+}
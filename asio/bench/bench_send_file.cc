@@ -0,0 +1,191 @@
+// measures stream::async_send_file() throughput from the page cache over
+// loopback. the file is written and read back once before timing, so every
+// run is served from memory
+//
+// usage: bench_send_file [megabytes] [iterations]
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include "global/global_init.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_server.h"
+#include "quic/quic_stream.h"
+
+#include "certificate.h"
+
+namespace
+{
+
+	size_t parse_arg(int argc, char** argv, int index, size_t default_value)
+	{
+		if (argc <= index)
+		{
+			return default_value;
+		}
+		const auto begin = argv[index];
+		const auto end = begin + ::strlen(begin);
+		size_t value = 0;
+		const auto result = std::from_chars(begin, end, value);
+		if (auto ec = std::make_error_code(result.ec); ec)
+		{
+			std::cerr << "failed to parse \"" << begin << "\": " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+		return value;
+	}
+
+	int make_file(size_t bytes)
+	{
+		char path[] = "/tmp/bench_send_file.XXXXXX";
+		const int fd = ::mkstemp(path);
+		if (fd == -1)
+		{
+			::perror("mkstemp");
+			::exit(EXIT_FAILURE);
+		}
+		::unlink(path);
+
+		auto chunk = std::vector<char>(1024 * 1024);
+		for (size_t i = 0; i < chunk.size(); i++)
+		{
+			chunk[i] = static_cast<char>(i);
+		}
+		for (size_t written = 0; written < bytes;)
+		{
+			const size_t n = std::min(chunk.size(), bytes - written);
+			if (::write(fd, chunk.data(), n) != static_cast<ssize_t>(n))
+			{
+				::perror("write");
+				::exit(EXIT_FAILURE);
+			}
+			written += n;
+		}
+		// read it back to make sure it's resident in the page cache
+		for (off_t offset = 0; ::pread(fd, chunk.data(), chunk.size(), offset) > 0;)
+		{
+			offset += chunk.size();
+		}
+		return fd;
+	}
+
+	quic::settings bench_settings()
+	{
+		auto s = quic::default_server_settings();
+		s.connection_flow_control_window = 16 * 1024 * 1024;
+		s.incoming_stream_flow_control_window = 16 * 1024 * 1024;
+		s.outgoing_stream_flow_control_window = 16 * 1024 * 1024;
+		return s;
+	}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	const size_t megabytes = parse_arg(argc, argv, 1, 1024);
+	const size_t iterations = parse_arg(argc, argv, 2, 3);
+	const size_t file_size = megabytes * 1024 * 1024;
+	const int fd = make_file(file_size);
+
+	auto context = boost::asio::io_context{};
+	auto ex = context.get_executor();
+	auto global = global::init_client_server();
+
+	const char* alpn = "\05bench";
+	auto ssl = test::init_server_context(alpn);
+	auto sslc = test::init_client_context(alpn);
+
+	auto server = quic::server{ ex, bench_settings() };
+	const auto localhost = boost::asio::ip::make_address("127.0.0.1");
+	auto acceptor = quic::acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+	acceptor.listen(16);
+
+	auto client = quic::client{ ex, udp::endpoint{}, sslc, bench_settings() };
+	auto cconn = quic::connection{ client, acceptor.local_endpoint(), "host" };
+
+	auto sconn = quic::connection{ acceptor };
+	bool accepted = false;
+	acceptor.async_accept(sconn, [&](error_code ec)
+	{
+		if (ec)
+		{
+			std::cerr << "accept failed with " << ec.message() << '\n';
+			::exit(EXIT_FAILURE);
+		}
+		accepted = true;
+	});
+	while (!accepted && context.run_one())
+	{
+	}
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto sstream = quic::stream{ sconn };
+		auto cstream = quic::stream{ cconn };
+		const auto start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point sent;
+		sconn.async_connect(sstream, [&](error_code ec)
+		{
+			if (ec)
+			{
+				std::cerr << "connect failed with " << ec.message() << '\n';
+				::exit(EXIT_FAILURE);
+			}
+			sstream.async_send_file(fd, 0, file_size, [&](error_code ec, size_t)
+			{
+				if (ec)
+				{
+					std::cerr << "async_send_file failed with " << ec.message() << '\n';
+					::exit(EXIT_FAILURE);
+				}
+				sent = std::chrono::steady_clock::now();
+				sstream.shutdown(1);
+			});
+		});
+
+		size_t received = 0;
+		auto buffer = std::array<char, 65536>{};
+		std::function<void(error_code, size_t)> on_read = [&](error_code ec, size_t bytes)
+		{
+			received += bytes;
+			if (!ec && bytes)
+			{
+				cstream.async_read_some(boost::asio::buffer(buffer), on_read);
+			}
+		};
+		cconn.async_accept(cstream, [&](error_code ec)
+		{
+			if (!ec)
+			{
+				cstream.async_read_some(boost::asio::buffer(buffer), on_read);
+			}
+		});
+
+		while (received < file_size && context.run_one())
+		{
+		}
+		const auto finish = std::chrono::steady_clock::now();
+
+		const auto seconds = std::chrono::duration<double>(finish - start).count();
+		const auto gbps = static_cast<double>(received) / seconds / (1024.0 * 1024.0 * 1024.0);
+		std::cout << "run " << i << ": " << received << " bytes in " << seconds
+				  << "s, " << gbps << " GB/s (send completed after "
+				  << std::chrono::duration<double>(sent - start).count() << "s)\n";
+		context.poll(); // let the stream close cleanly
+	}
+
+	cconn.close();
+	::close(fd);
+	return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+namespace h3
+{
+
+	/// extensible priority parameters from RFC 9218. lower urgency is sent
+	/// first; incremental streams of the same urgency share bandwidth, while
+	/// non-incremental ones are sent one after another
+	struct priority
+	{
+		uint8_t urgency = 3; // 0 through 7
+		bool incremental = false;
+	};
+
+} // namespace h3
@@ -50,4 +50,33 @@ namespace h3
 		}
 	}
 
+	void stream::set_http_priority(const h3::priority& prio, error_code& ec)
+	{
+		impl.set_http_priority(prio, ec);
+	}
+	void stream::set_http_priority(const h3::priority& prio)
+	{
+		error_code ec;
+		set_http_priority(prio, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	h3::priority stream::http_priority(error_code& ec) const
+	{
+		return impl.http_priority(ec);
+	}
+	h3::priority stream::http_priority() const
+	{
+		error_code ec;
+		auto prio = http_priority(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return prio;
+	}
+
 } // namespace h3
@@ -2,6 +2,7 @@
 
 #include "../quic/quic_stream.h"
 #include "h3_fields.h"
+#include "h3_priority.h"
 
 namespace h3
 {
@@ -21,7 +22,7 @@ namespace h3
 		template<typename CompletionToken>
 		decltype(auto) async_read_headers(fields& f, CompletionToken&& token)
 		{
-			return impl.async_read_headers(f, std::forward<CompletionToken>(token));
+			return impl.async_read_headers(impl.get_executor(), f, std::forward<CompletionToken>(token));
 		}
 
 		void read_headers(fields& f, error_code& ec);
@@ -30,11 +31,21 @@ namespace h3
 		template<typename CompletionToken>
 		decltype(auto) async_write_headers(const fields& f, CompletionToken&& token)
 		{
-			return impl.async_write_headers(f, std::forward<CompletionToken>(token));
+			return impl.async_write_headers(impl.get_executor(), f, std::forward<CompletionToken>(token));
 		}
 
 		void write_headers(const fields& f, error_code& ec);
 		void write_headers(const fields& f);
+
+		/// set the stream's RFC 9218 priority. extensible priorities are on by
+		/// default in http mode, and lsquic schedules by urgency first, then
+		/// interleaves incremental streams or finishes non-incremental ones in
+		/// order. fails with operation_not_supported when they are disabled
+		void set_http_priority(const h3::priority& prio, error_code& ec);
+		void set_http_priority(const h3::priority& prio);
+
+		h3::priority http_priority(error_code& ec) const;
+		h3::priority http_priority() const;
 	};
 
 } // namespace h3
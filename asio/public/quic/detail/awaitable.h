@@ -0,0 +1,139 @@
+#pragma once
+
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/defer.hpp>
+#include <boost/asio/post.hpp>
+
+#include "operation.h"
+
+namespace quic::detail
+{
+
+	// resumes the coroutine waiting on an operation. it always goes through
+	// the executor, never inline, so the coroutine doesn't run on whatever
+	// thread completed the operation or before await_suspend() has returned
+	struct coroutine_resumer
+	{
+		static void resume(completion_type type, std::coroutine_handle<> h,
+			const boost::asio::any_io_executor& ex)
+		{
+			if (type == completion_type::defer || type == completion_type::deferred)
+			{
+				boost::asio::defer(ex, [h]
+				{ h.resume(); });
+			}
+			else
+			{
+				boost::asio::post(ex, [h]
+				{ h.resume(); });
+			}
+		}
+	};
+
+	// an operation that lives in the coroutine frame. there's no handler to
+	// allocate, the completion just stores its result and resumes
+	template<typename Operation>
+	struct awaitable_operation : Operation
+	{
+		using operation_type = typename Operation::operation_type;
+		using tuple_type = typename Operation::tuple_type;
+
+		boost::asio::any_io_executor work; // keeps the io_context running
+		std::coroutine_handle<> continuation;
+		std::optional<tuple_type> result;
+
+		template<typename ...Args>
+		explicit awaitable_operation(const boost::asio::any_io_executor& ex, Args&& ...args)
+			: Operation(do_complete, std::forward<Args>(args)...),
+			  work(boost::asio::prefer(ex, boost::asio::execution::outstanding_work.tracked))
+		{
+		}
+
+		static void do_complete(completion_type type, operation_type* op, tuple_type&& args)
+		{
+			auto self = static_cast<awaitable_operation*>(op);
+			if (type == completion_type::destroy)
+			{
+				return; // shut down, the coroutine is never resumed
+			}
+			self->result = std::move(args);
+			if (type == completion_type::queue)
+			{
+				completion_batch::current->push(*self, run_queued);
+				return;
+			}
+			coroutine_resumer::resume(type, self->continuation, self->work);
+		}
+
+		static void run_queued(deferred_completion* c)
+		{
+			auto self = static_cast<awaitable_operation*>(c);
+			coroutine_resumer::resume(completion_type::deferred, self->continuation, self->work);
+		}
+	};
+
+	// starts the operation once the coroutine has suspended. co_await yields
+	// the completion's size_t, if it has one, and throws system_error on
+	// failure unless an error_code was given
+	template<typename Impl, typename Operation>
+	class operation_awaiter
+	{
+	public:
+		using start_fn = void (Impl::*)(Operation&);
+	private:
+		Impl& impl;
+		start_fn start;
+		error_code* ec;
+		awaitable_operation<Operation> op;
+	public:
+		template<typename Prepare, typename ...Args>
+		operation_awaiter(Impl& impl, start_fn start, error_code* ec, Prepare&& prepare, Args&& ...args)
+			: impl(impl), start(start), ec(ec), op(impl.get_executor(), std::forward<Args>(args)...)
+		{
+			prepare(static_cast<Operation&>(op));
+		}
+
+		operation_awaiter(const operation_awaiter&) = delete;
+		operation_awaiter& operator=(const operation_awaiter&) = delete;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> h)
+		{
+			op.continuation = h;
+			(impl.*start)(op); // h resumes through the executor, later
+		}
+
+		auto await_resume()
+		{
+			auto& r = *op.result;
+			if (ec)
+			{
+				*ec = std::get<0>(r);
+			}
+			else if (std::get<0>(r))
+			{
+				throw system_error(std::get<0>(r));
+			}
+			if constexpr (std::tuple_size_v<typename Operation::tuple_type> > 1)
+			{
+				return std::get<1>(r);
+			}
+		}
+	};
+
+	struct no_prepare
+	{
+		template<typename Operation>
+		void operator()(Operation&) const
+		{
+		}
+	};
+
+} // namespace quic::detail
@@ -0,0 +1,84 @@
+#pragma once
+
+namespace quic::detail
+{
+
+	// an operation whose defer() was held back by a completion_batch. the
+	// link lives in the operation so queueing never allocates
+	struct deferred_completion
+	{
+		deferred_completion* next = nullptr;
+		void (*run)(deferred_completion*) = nullptr;
+	};
+
+	// while an engine runs lsquic callbacks under its mutex, operations
+	// completed with defer() are queued here instead of being handed to
+	// their executors one by one. the operation keeps its own result until
+	// the queue runs, in order, once the engine mutex is released
+	struct completion_batch
+	{
+		// the batch collecting completions on this thread, if any
+		static inline thread_local completion_batch* current = nullptr;
+
+		deferred_completion* head = nullptr;
+		deferred_completion* tail = nullptr;
+
+		bool empty() const
+		{
+			return head == nullptr;
+		}
+
+		void push(deferred_completion& c, void (*run)(deferred_completion*))
+		{
+			c.run = run;
+			c.next = nullptr;
+			if (tail)
+			{
+				tail->next = &c;
+			}
+			else
+			{
+				head = &c;
+			}
+			tail = &c;
+		}
+
+		// detach the queue so it can run without the engine mutex
+		deferred_completion* release()
+		{
+			tail = nullptr;
+			auto c = head;
+			head = nullptr;
+			return c;
+		}
+
+		static void run(deferred_completion* c)
+		{
+			while (c)
+			{
+				auto next = c->next; // run() may free c
+				c->run(c);
+				c = next;
+			}
+		}
+	};
+
+	// collect completions into `batch` for the lifetime of the scope
+	class completion_batch_scope
+	{
+		completion_batch* prev;
+	public:
+		explicit completion_batch_scope(completion_batch& batch) noexcept
+			: prev(completion_batch::current)
+		{
+			completion_batch::current = &batch;
+		}
+		~completion_batch_scope()
+		{
+			completion_batch::current = prev;
+		}
+		completion_batch_scope(const completion_batch_scope&) = delete;
+		completion_batch_scope& operator=(const completion_batch_scope&) = delete;
+	};
+
+} // namespace quic::detail
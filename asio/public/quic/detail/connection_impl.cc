@@ -14,6 +14,10 @@ namespace quic
 					  boost::asio::query(socket.get_executor(), boost::asio::execution::context)
 				  )
 			  ),
+			  _stream_svc(boost::asio::use_service<service<stream_impl>>(
+					  boost::asio::query(socket.get_executor(), boost::asio::execution::context)
+				  )
+			  ),
 			  _socket(socket),
 			  _state(connection_state::closed{})
 		{
@@ -56,12 +60,22 @@ namespace quic
 		}
 
 		void connection_impl::connect(stream_connect_operation& op)
+		{
+			connect(op, no_deadline);
+		}
+
+		void connection_impl::connect(stream_connect_operation& op, deadline_clock::time_point deadline)
 		{
 			auto lock = std::unique_lock{ _socket.engine.mutex };
+			op.stream.set_deadline(op.stream.read_deadline, &op, deadline);
 			if (connection_state::stream_connect(_state, op))
 			{
 				_socket.engine.process(lock);
 			}
+			else if (deadline != no_deadline)
+			{
+				_socket.engine.reschedule(lock);
+			}
 		}
 
 		stream_impl* connection_impl::on_connect(lsquic_stream_t* stream)
@@ -70,14 +84,115 @@ namespace quic
 		}
 
 		void connection_impl::accept(stream_accept_operation& op)
+		{
+			accept(op, no_deadline);
+		}
+
+		void connection_impl::accept(stream_accept_operation& op, deadline_clock::time_point deadline)
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			op.stream.set_deadline(op.stream.read_deadline, &op, deadline);
+			if (connection_state::stream_accept(_state, op, _socket.engine.is_http))
+			{
+				_socket.engine.process(lock);
+			}
+			else if (deadline != no_deadline)
+			{
+				_socket.engine.reschedule(lock);
+			}
+		}
+
+		void connection_impl::accept_some(stream_accept_batch_operation& op)
 		{
 			auto lock = std::unique_lock{ _socket.engine.mutex };
-			connection_state::stream_accept(_state, op, _socket.engine.is_http);
+			if (connection_state::stream_accept_batch(_state, op, _socket.engine.is_http))
+			{
+				_socket.engine.process(lock);
+			}
 		}
 
 		stream_impl* connection_impl::on_accept(lsquic_stream* stream)
 		{
-			return connection_state::on_stream_accept(_state, stream, _socket.engine.is_http);
+			if (_socket.engine.budget.pressure())
+			{
+				::lsquic_stream_close(stream);
+				return nullptr;
+			}
+			bool flush = false;
+			auto s = connection_state::on_stream_accept(_state, stream, _socket.engine.is_http, flush);
+			if (flush)
+			{
+				_socket.engine.flush_connections.push_back(this);
+			}
+			return s;
+		}
+
+		void connection_impl::send_datagram(datagram_operation& op)
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			if (connection_state::send_datagram(_state, op))
+			{
+				_socket.engine.process(lock);
+			}
+		}
+
+		ssize_t connection_impl::on_datagram_write(void* buf, size_t size)
+		{
+			return connection_state::on_datagram_write(_state, buf, size);
+		}
+
+		void connection_impl::receive_datagram(datagram_operation& op)
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			connection_state::receive_datagram(_state, op);
+		}
+
+		void connection_impl::on_datagram(const void* buf, size_t size)
+		{
+			connection_state::on_datagram(_state, buf, size);
+		}
+
+		void connection_impl::set_datagram_queue_size(size_t size, error_code& ec)
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			connection_state::set_datagram_queue_size(_state, size, ec);
+		}
+
+		quic::datagram_stats connection_impl::datagram_stats(error_code& ec) const
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			return connection_state::get_datagram_stats(_state, ec);
+		}
+
+		size_t connection_impl::memory_usage() const
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			return sizeof(*this) + connection_state::memory_usage(_state);
+		}
+
+		void connection_impl::wait_readable(readable_operation& op)
+		{
+			auto lock = std::unique_lock{ _socket.engine.mutex };
+			if (connection_state::wait_readable(_state, op))
+			{
+				_socket.engine.process(lock);
+			}
+		}
+
+		void connection_impl::on_stream_readable(stream_impl& s)
+		{
+			error_code ec;
+			const auto sid = stream_state::id(s.state, ec);
+			if (connection_state::on_stream_readable(_state, sid))
+			{
+				_socket.engine.flush_connections.push_back(this);
+			}
+		}
+
+		void connection_impl::flush()
+		{
+			connection_state::flush_readable(_state);
+			connection_state::flush_accept_batch(_state);
 		}
 
 		void connection_impl::go_away(error_code& ec)
@@ -179,11 +294,7 @@ namespace quic
 
 		void connection_impl::on_accepting_stream_closed(stream_impl& s)
 		{
-			if (std::holds_alternative<connection_state::open>(_state))
-			{
-				auto& o = *std::get_if<connection_state::open>(&_state);
-				list_erase(s, o.accepting_streams);
-			}
+			connection_state::on_accepting_stream_closed(_state, s);
 		}
 
 		void connection_impl::on_connecting_stream_closed(stream_impl& s)
@@ -18,9 +18,10 @@ namespace quic::detail
 
 	struct connection_impl : public connection_context,
 							 public boost::intrusive::list_base_hook<>,
-							 public service_list_base_hook
+							 public service_entry
 	{
 		service<connection_impl>& _svc;
+		service<stream_impl>& _stream_svc; // looked up once instead of per stream
 		socket_impl& _socket;
 		connection_state::variant _state;
 
@@ -36,43 +37,167 @@ namespace quic::detail
 		udp::endpoint remote_endpoint(error_code& ec) const;
 
 		void connect(stream_connect_operation& op);
+		void connect(stream_connect_operation& op, deadline_clock::time_point deadline);
 		stream_impl* on_connect(lsquic_stream* stream);
 
 		template<typename Stream, typename CompletionToken>
-		decltype(auto) async_connect(Stream& stream, CompletionToken&& token)
+		decltype(auto) async_connect(Stream& stream, deadline_clock::time_point deadline, CompletionToken&& token)
 		{
 			auto& s = stream.impl;
 			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
-				[this, &s](auto h)
+				[this, &s, deadline](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
 					using op_type = stream_connect_async<Handler, executor_type>;
 					auto p = handler_allocate<op_type>(h, std::move(h), get_executor(), s);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
-					connect(*op);
+					connect(*op, deadline);
 					op.release();
 				}, token);
 		}
 
+		template<typename Stream, typename CompletionToken>
+		decltype(auto) async_connect(Stream& stream, CompletionToken&& token)
+		{
+			return async_connect(stream, no_deadline, std::forward<CompletionToken>(token));
+		}
+
 		void accept(stream_accept_operation& op);
+		void accept(stream_accept_operation& op, deadline_clock::time_point deadline);
+		void accept_some(stream_accept_batch_operation& op);
 		stream_impl* on_accept(lsquic_stream* stream);
 
 		template<typename Stream, typename CompletionToken>
-		decltype(auto) async_accept(Stream& stream, CompletionToken&& token)
+		decltype(auto) async_accept(Stream& stream, deadline_clock::time_point deadline, CompletionToken&& token)
 		{
 			auto& s = stream.impl;
 			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
-				[this, &s](auto h)
+				[this, &s, deadline](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
 					using op_type = stream_accept_async<Handler, executor_type>;
 					auto p = handler_allocate<op_type>(h, std::move(h), get_executor(), s);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
-					accept(*op);
+					accept(*op, deadline);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		template<typename Stream, typename CompletionToken>
+		decltype(auto) async_accept(Stream& stream, CompletionToken&& token)
+		{
+			return async_accept(stream, no_deadline, std::forward<CompletionToken>(token));
+		}
+
+		// a range of streams, or of pointers to them
+		template<typename StreamRange>
+		static std::vector<stream_impl*> stream_impls(StreamRange&& streams)
+		{
+			auto impls = std::vector<stream_impl*>{};
+			for (auto& s : streams)
+			{
+				if constexpr (requires { s->impl; })
+				{
+					impls.push_back(&s->impl);
+				}
+				else
+				{
+					impls.push_back(&s.impl);
+				}
+			}
+			return impls;
+		}
+
+		template<typename StreamRange, typename CompletionToken>
+		decltype(auto) async_accept_some(StreamRange&& streams, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, impls = stream_impls(streams)](auto h) mutable
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = stream_accept_batch_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), get_executor(), std::move(impls));
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					accept_some(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		template<typename BufferSequence>
+		static void init_op(const BufferSequence& buffers, datagram_operation& op)
+		{
+			const auto end = boost::asio::buffer_sequence_end(buffers);
+			for (auto i = boost::asio::buffer_sequence_begin(buffers);
+				 i != end && op.num_iovs < op.max_iovs;
+				 ++i, ++op.num_iovs)
+			{
+				op.iovs[op.num_iovs].iov_base = const_cast<void*>(i->data());
+				op.iovs[op.num_iovs].iov_len = i->size();
+			}
+		}
+
+		void send_datagram(datagram_operation& op);
+		ssize_t on_datagram_write(void* buf, size_t size);
+
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_send_datagram(const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, &buffers](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = datagram_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					init_op(buffers, *op);
+					send_datagram(*op);
 					op.release(); // release ownership
 				}, token);
 		}
 
+		void receive_datagram(datagram_operation& op);
+		void on_datagram(const void* buf, size_t size);
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_receive_datagram(const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, &buffers](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = datagram_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					init_op(buffers, *op);
+					receive_datagram(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		void wait_readable(readable_operation& op);
+		void on_stream_readable(stream_impl& s);
+		void flush(); // completions batched over an engine pass
+
+		template<typename CompletionToken>
+		decltype(auto) async_wait_readable(std::vector<stream_id>& ids, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
+				[this, &ids](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = readable_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), get_executor(), ids);
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					wait_readable(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		void set_datagram_queue_size(size_t size, error_code& ec);
+		quic::datagram_stats datagram_stats(error_code& ec) const;
+
+		size_t memory_usage() const;
+
 		bool is_open() const;
 
 		void go_away(error_code& ec);
@@ -71,11 +71,11 @@ namespace quic::detail::connection_state
 		return remote;
 	}
 
-	void on_connect(variant& state, lsquic_conn* handle)
+	void on_connect(variant& state, lsquic_conn* handle, memory_charge&& charge)
 	{
 		assert(handle);
 		assert(std::holds_alternative<closed>(state));
-		state.emplace<open>(*handle);
+		state.emplace<open>(*handle, std::move(charge));
 	}
 
 	void on_handshake(variant& state, int status)
@@ -114,16 +114,16 @@ namespace quic::detail::connection_state
 	{
 		assert(std::holds_alternative<closed>(state));
 		assert(incoming.handle);
-		auto& o = state.emplace<open>(*incoming.handle);
+		auto& o = state.emplace<open>(*incoming.handle, std::move(incoming.charge));
 		o.incoming_streams = std::move(incoming.incoming_streams);
 	}
 
-	void on_accept(variant& state, lsquic_conn* handle)
+	void on_accept(variant& state, lsquic_conn* handle, memory_charge&& charge)
 	{
 		assert(handle);
 		assert(std::holds_alternative<accepting>(state));
 		std::get_if<accepting>(&state)->op->defer(error_code{}); // success
-		state.emplace<open>(*handle);
+		state.emplace<open>(*handle, std::move(charge));
 	}
 
 	bool stream_connect(variant& state, stream_connect_operation& op)
@@ -145,6 +145,13 @@ namespace quic::detail::connection_state
 			return false;
 		}
 
+		error_code ec;
+		stream_state::reopen(op.stream.state, ec);
+		if (ec)
+		{
+			op.post(ec);
+			return false;
+		}
 		auto& o = *std::get_if<open>(&state);
 		stream_state::connect(op.stream.state, op);
 		o.connecting_streams.push_back(op.stream);
@@ -156,52 +163,143 @@ namespace quic::detail::connection_state
 	{
 		assert(std::holds_alternative<open>(state));
 		auto& o = *std::get_if<open>(&state);
-		assert(!o.connecting_streams.empty());
+		if (o.connecting_streams.empty())
+		{
+			// the connect this was made for timed out or was reset
+			::lsquic_stream_close(handle);
+			return nullptr;
+		}
 		auto& s = o.connecting_streams.front();
 		list_transfer(s, o.connecting_streams, o.open_streams);
 		stream_state::on_connect(s.state, handle, is_http);
+		if (o.readable.watching)
+		{
+			stream_state::watch_readable(s.state);
+		}
 		return &s;
 	}
 
-	void stream_accept(variant& state, stream_accept_operation& op, bool is_http)
+	static void accept_incoming_stream(open& o, stream_impl& s, bool is_http)
+	{
+		auto handle = o.incoming_streams.front();
+		o.incoming_streams.pop_front();
+		stream_state::on_accept(s.state, handle, is_http);
+		o.open_streams.push_back(s);
+
+		auto ctx = reinterpret_cast<lsquic_stream_ctx_t*>(&s);
+		::lsquic_stream_set_ctx(handle, ctx);
+		if (o.readable.watching)
+		{
+			stream_state::watch_readable(s.state);
+		}
+	}
+
+	bool stream_accept(variant& state, stream_accept_operation& op, bool is_http)
 	{
 		if (std::holds_alternative<error>(state))
 		{
 			op.post(std::get_if<error>(&state)->ec);
 			state = closed{};
-			return;
+			return false;
 		}
 		else if (std::holds_alternative<going_away>(state))
 		{
 			op.post(make_error_code(connection_error::going_away));
-			return;
+			return false;
 		}
 		else if (!std::holds_alternative<open>(state))
 		{
 			op.post(make_error_code(errc::bad_file_descriptor));
-			return;
+			return false;
+		}
+		error_code ec;
+		stream_state::reopen(op.stream.state, ec);
+		if (ec)
+		{
+			op.post(ec);
+			return false;
 		}
 		auto& o = *std::get_if<open>(&state);
 		if (!o.incoming_streams.empty())
 		{
-			auto handle = o.incoming_streams.front();
-			o.incoming_streams.pop_front();
-			stream_state::on_accept(op.stream.state, handle, is_http);
-			o.open_streams.push_back(op.stream);
-
-			auto ctx = reinterpret_cast<lsquic_stream_ctx_t*>(&op.stream);
-			::lsquic_stream_set_ctx(handle, ctx);
+			accept_incoming_stream(o, op.stream, is_http);
 			op.post(error_code{}); // success
-			return;
+			// if watched, it may already have data that lsquic reports on the next tick
+			return o.readable.watching;
 		}
 		stream_state::accept(op.stream.state, op);
 		o.accepting_streams.push_back(op.stream);
+		return false;
+	}
+
+	bool stream_accept_batch(variant& state, stream_accept_batch_operation& op, bool is_http)
+	{
+		if (std::holds_alternative<error>(state))
+		{
+			op.post(std::get_if<error>(&state)->ec, 0);
+			state = closed{};
+			return false;
+		}
+		else if (std::holds_alternative<going_away>(state))
+		{
+			op.post(make_error_code(connection_error::going_away), 0);
+			return false;
+		}
+		else if (!std::holds_alternative<open>(state))
+		{
+			op.post(make_error_code(errc::bad_file_descriptor), 0);
+			return false;
+		}
+		auto& o = *std::get_if<open>(&state);
+		if (o.batch.op)
+		{
+			op.post(make_error_code(errc::invalid_argument), 0);
+			return false;
+		}
+		for (auto s : op.streams)
+		{
+			error_code ec;
+			stream_state::reopen(s->state, ec);
+			if (ec)
+			{
+				op.post(ec, 0);
+				return false;
+			}
+		}
+		// take everything that's already queued without waiting
+		size_t accepted = 0;
+		while (accepted < op.streams.size() && !o.incoming_streams.empty())
+		{
+			accept_incoming_stream(o, *op.streams[accepted++], is_http);
+		}
+		if (accepted || op.streams.empty())
+		{
+			op.post(error_code{}, accepted);
+			return accepted && o.readable.watching;
+		}
+		for (auto s : op.streams)
+		{
+			stream_state::accept(s->state);
+			o.accepting_streams.push_back(*s);
+		}
+		op.streams = {}; // tracked on accepting_streams from here
+		o.batch.op = &op;
+		o.batch.accepted = 0;
+		return false;
+	}
+
+	// batch members wait in accepting_streams without an op of their own
+	static bool is_batch_member(const stream_impl& s)
+	{
+		const auto a = std::get_if<stream_state::accepting>(&s.state);
+		return a && !a->op;
 	}
 
-	stream_impl* on_stream_accept(variant& state, lsquic_stream* handle, bool is_http)
+	stream_impl* on_stream_accept(variant& state, lsquic_stream* handle, bool is_http, bool& flush)
 	{
 		assert(std::holds_alternative<open>(state));
 		auto& o = *std::get_if<open>(&state);
+		flush = false;
 		if (o.accepting_streams.empty())
 		{
 			if (o.incoming_streams.full())
@@ -216,11 +314,349 @@ namespace quic::detail::connection_state
 		}
 
 		auto& s = o.accepting_streams.front();
+		const bool batched = is_batch_member(s);
 		list_transfer(s, o.accepting_streams, o.open_streams);
 		stream_state::on_accept(s.state, handle, is_http);
+		if (o.readable.watching)
+		{
+			stream_state::watch_readable(s.state);
+		}
+		if (batched)
+		{
+			o.batch.accepted++;
+			if (!o.batch.flushing)
+			{
+				o.batch.flushing = true;
+				flush = true;
+			}
+		}
 		return &s;
 	}
 
+	void flush_accept_batch(variant& state)
+	{
+		if (!std::holds_alternative<open>(state))
+		{
+			return;
+		}
+		auto& o = *std::get_if<open>(&state);
+		o.batch.flushing = false;
+		if (!o.batch.op || !o.batch.accepted)
+		{
+			return;
+		}
+		auto op = std::exchange(o.batch.op, nullptr);
+		// members that are still waiting go back to closed
+		for (auto i = o.accepting_streams.begin(); i != o.accepting_streams.end();)
+		{
+			auto& s = *i++;
+			if (is_batch_member(s))
+			{
+				list_erase(s, o.accepting_streams);
+				s.state = stream_state::closed{};
+			}
+		}
+		op->defer(error_code{}, std::exchange(o.batch.accepted, 0));
+	}
+
+	void on_accepting_stream_closed(variant& state, stream_impl& s)
+	{
+		if (!std::holds_alternative<open>(state))
+		{
+			return;
+		}
+		auto& o = *std::get_if<open>(&state);
+		list_erase(s, o.accepting_streams);
+		if (!o.batch.op)
+		{
+			return;
+		}
+		for (const auto& other : o.accepting_streams)
+		{
+			if (is_batch_member(other))
+			{
+				return;
+			}
+		}
+		// the last waiting member is gone. complete with what was accepted
+		auto op = std::exchange(o.batch.op, nullptr);
+		const size_t accepted = std::exchange(o.batch.accepted, 0);
+		op->defer(accepted ? error_code{} : make_error_code(stream_error::aborted), accepted);
+	}
+
+	// datagrams keep flowing while the connection is going away. the queues
+	// are only allocated once something needs them, which most connections
+	// never do
+	static std::unique_ptr<datagram_state::queues>* get_datagrams(variant& state,
+		lsquic_conn*& handle, memory_budget*& budget)
+	{
+		if (std::holds_alternative<open>(state))
+		{
+			auto& o = *std::get_if<open>(&state);
+			handle = &o.handle;
+			budget = o.charge.budget();
+			return &o.datagrams;
+		}
+		if (std::holds_alternative<going_away>(state))
+		{
+			auto& g = *std::get_if<going_away>(&state);
+			handle = &g.handle;
+			budget = g.charge.budget();
+			return &g.datagrams;
+		}
+		return nullptr;
+	}
+
+	static datagram_state::queues& make_datagrams(std::unique_ptr<datagram_state::queues>& q,
+		memory_budget* budget)
+	{
+		if (!q)
+		{
+			q = std::make_unique<datagram_state::queues>();
+			if (budget)
+			{
+				q->charge = memory_charge{ *budget };
+			}
+		}
+		return *q;
+	}
+
+	bool send_datagram(variant& state, datagram_operation& op)
+	{
+		if (std::holds_alternative<error>(state))
+		{
+			op.post(std::get_if<error>(&state)->ec, 0);
+			state = closed{};
+			return false;
+		}
+		lsquic_conn* handle = nullptr;
+		memory_budget* budget = nullptr;
+		auto q = get_datagrams(state, handle, budget);
+		if (!q)
+		{
+			op.post(make_error_code(errc::not_connected), 0);
+			return false;
+		}
+		return datagram_state::send(make_datagrams(*q, budget), handle, op);
+	}
+
+	ssize_t on_datagram_write(variant& state, void* buf, size_t size)
+	{
+		lsquic_conn* handle = nullptr;
+		memory_budget* budget = nullptr;
+		auto q = get_datagrams(state, handle, budget);
+		if (!q || !*q)
+		{
+			return -1;
+		}
+		return datagram_state::on_write(**q, handle, buf, size);
+	}
+
+	void receive_datagram(variant& state, datagram_operation& op)
+	{
+		if (std::holds_alternative<error>(state))
+		{
+			op.post(std::get_if<error>(&state)->ec, 0);
+			state = closed{};
+			return;
+		}
+		lsquic_conn* handle = nullptr;
+		memory_budget* budget = nullptr;
+		auto q = get_datagrams(state, handle, budget);
+		if (!q)
+		{
+			op.post(make_error_code(errc::not_connected), 0);
+			return;
+		}
+		datagram_state::receive(make_datagrams(*q, budget), op);
+	}
+
+	void on_datagram(variant& state, const void* buf, size_t size)
+	{
+		lsquic_conn* handle = nullptr;
+		memory_budget* budget = nullptr;
+		if (auto q = get_datagrams(state, handle, budget); q)
+		{
+			datagram_state::on_receive(make_datagrams(*q, budget), buf, size);
+		}
+	}
+
+	void set_datagram_queue_size(variant& state, size_t size, error_code& ec)
+	{
+		lsquic_conn* handle = nullptr;
+		memory_budget* budget = nullptr;
+		auto q = get_datagrams(state, handle, budget);
+		if (!q)
+		{
+			ec = make_error_code(errc::not_connected);
+			return;
+		}
+		if (size == 0)
+		{
+			ec = make_error_code(errc::invalid_argument);
+			return;
+		}
+		datagram_state::set_limit(make_datagrams(*q, budget), size);
+		ec = error_code{};
+	}
+
+	datagram_stats get_datagram_stats(const variant& state, error_code& ec)
+	{
+		if (std::holds_alternative<open>(state))
+		{
+			ec = error_code{};
+			const auto& q = std::get_if<open>(&state)->datagrams;
+			return q ? q->stats : datagram_stats{};
+		}
+		if (std::holds_alternative<going_away>(state))
+		{
+			ec = error_code{};
+			const auto& q = std::get_if<going_away>(&state)->datagrams;
+			return q ? q->stats : datagram_stats{};
+		}
+		ec = make_error_code(errc::not_connected);
+		return {};
+	}
+
+	static readable_streams* get_readable(variant& state, stream_list*& streams)
+	{
+		if (std::holds_alternative<open>(state))
+		{
+			auto& o = *std::get_if<open>(&state);
+			streams = &o.open_streams;
+			return &o.readable;
+		}
+		if (std::holds_alternative<going_away>(state))
+		{
+			auto& g = *std::get_if<going_away>(&state);
+			streams = &g.open_streams;
+			return &g.readable;
+		}
+		return nullptr;
+	}
+
+	static size_t memory_usage(const std::unique_ptr<datagram_state::queues>& q,
+		const readable_streams& readable)
+	{
+		size_t bytes = readable.ready.capacity() * sizeof(stream_id);
+		if (q)
+		{
+			bytes += datagram_state::memory_usage(*q);
+		}
+		return bytes;
+	}
+
+	size_t memory_usage(const variant& state)
+	{
+		if (std::holds_alternative<open>(state))
+		{
+			const auto& o = *std::get_if<open>(&state);
+			return o.incoming_streams.memory_usage() + memory_usage(o.datagrams, o.readable);
+		}
+		if (std::holds_alternative<going_away>(state))
+		{
+			const auto& g = *std::get_if<going_away>(&state);
+			return memory_usage(g.datagrams, g.readable);
+		}
+		return 0;
+	}
+
+	bool wait_readable(variant& state, readable_operation& op)
+	{
+		if (std::holds_alternative<error>(state))
+		{
+			op.post(std::get_if<error>(&state)->ec);
+			state = closed{};
+			return false;
+		}
+		stream_list* streams = nullptr;
+		auto r = get_readable(state, streams);
+		if (!r)
+		{
+			op.post(make_error_code(errc::not_connected));
+			return false;
+		}
+		if (r->op)
+		{
+			op.post(make_error_code(errc::invalid_argument));
+			return false;
+		}
+		bool process = false;
+		if (!r->watching)
+		{
+			r->watching = true;
+			for (auto& s : *streams)
+			{
+				stream_state::watch_readable(s.state);
+			}
+			process = true;
+		}
+		if (!r->ready.empty())
+		{
+			op.ids = std::exchange(r->ready, {}); // an idle connection keeps no capacity
+			op.post(error_code{});
+			return process;
+		}
+		r->op = &op;
+		return process;
+	}
+
+	bool on_stream_readable(variant& state, stream_id id)
+	{
+		stream_list* streams = nullptr;
+		auto r = get_readable(state, streams);
+		if (!r)
+		{
+			return false;
+		}
+		r->ready.push_back(id);
+		if (!r->op || r->flushing)
+		{
+			return false;
+		}
+		r->flushing = true;
+		return true;
+	}
+
+	void flush_readable(variant& state)
+	{
+		stream_list* streams = nullptr;
+		auto r = get_readable(state, streams);
+		if (!r)
+		{
+			return;
+		}
+		r->flushing = false;
+		if (r->op && !r->ready.empty())
+		{
+			auto op = std::exchange(r->op, nullptr);
+			op->ids = std::exchange(r->ready, {});
+			op->defer(error_code{});
+		}
+	}
+
+	static int cancel_readable(readable_streams& r, error_code ec)
+	{
+		r.ready = {};
+		if (auto op = std::exchange(r.op, nullptr); op)
+		{
+			op->defer(ec);
+			return 1;
+		}
+		return 0;
+	}
+
+	static int cancel_accept_batch(accept_batch& b, error_code ec)
+	{
+		b.accepted = 0;
+		if (auto op = std::exchange(b.op, nullptr); op)
+		{
+			op->defer(ec, 0);
+			return 1;
+		}
+		return 0;
+	}
+
 	static int abort_streams(stream_list& streams, error_code ec)
 	{
 		int canceled = 0;
@@ -234,7 +670,7 @@ namespace quic::detail::connection_state
 		return canceled;
 	}
 
-	static void close_handles(boost::circular_buffer<lsquic_stream*>& handles)
+	static void close_handles(incoming_stream_queue& handles)
 	{
 		while (!handles.empty())
 		{
@@ -250,8 +686,14 @@ namespace quic::detail::connection_state
 		close_handles(state.incoming_streams);
 		canceled += abort_streams(state.connecting_streams, ec);
 		canceled += abort_streams(state.accepting_streams, ec);
+		canceled += cancel_accept_batch(state.batch, ec);
 		canceled += abort_streams(state.open_streams, ec);
 		canceled += abort_streams(state.closing_streams, ec);
+		if (state.datagrams)
+		{
+			canceled += datagram_state::cancel(*state.datagrams, ec);
+		}
+		canceled += cancel_readable(state.readable, ec);
 		return canceled;
 	}
 
@@ -260,6 +702,11 @@ namespace quic::detail::connection_state
 		int canceled = 0;
 		canceled += abort_streams(state.open_streams, ec);
 		canceled += abort_streams(state.closing_streams, ec);
+		if (state.datagrams)
+		{
+			canceled += datagram_state::cancel(*state.datagrams, ec);
+		}
+		canceled += cancel_readable(state.readable, ec);
 		return canceled;
 	}
 
@@ -268,15 +715,21 @@ namespace quic::detail::connection_state
 		close_handles(o.incoming_streams);
 		abort_streams(o.connecting_streams, ec);
 		abort_streams(o.accepting_streams, ec);
+		cancel_accept_batch(o.batch, ec);
 
 		auto& handle = o.handle;
 		auto open = std::move(o.open_streams);
 		auto closing = std::move(o.closing_streams);
+		auto datagrams = std::move(o.datagrams);
+		auto readable = std::move(o.readable);
+		auto charge = std::move(o.charge);
 		auto conn_ec = o.ec;
 
-		auto& g = state.emplace<going_away>(handle);
+		auto& g = state.emplace<going_away>(handle, std::move(charge));
 		g.open_streams = std::move(open);
 		g.closing_streams = std::move(closing);
+		g.datagrams = std::move(datagrams);
+		g.readable = std::move(readable);
 		g.ec = conn_ec;
 	}
 
@@ -474,6 +927,34 @@ namespace quic::detail::connection_state
 		{
 			std::get_if<accepting>(&state)->op->destroy(error_code{});
 		}
+		else if (std::holds_alternative<open>(state))
+		{
+			auto& o = *std::get_if<open>(&state);
+			if (o.datagrams)
+			{
+				datagram_state::destroy(*o.datagrams);
+			}
+			if (o.readable.op)
+			{
+				o.readable.op->destroy(error_code{});
+			}
+			if (o.batch.op)
+			{
+				o.batch.op->destroy(error_code{}, 0);
+			}
+		}
+		else if (std::holds_alternative<going_away>(state))
+		{
+			auto& g = *std::get_if<going_away>(&state);
+			if (g.datagrams)
+			{
+				datagram_state::destroy(*g.datagrams);
+			}
+			if (g.readable.op)
+			{
+				g.readable.op->destroy(error_code{});
+			}
+		}
 	}
 
 } // namespace quic::detail
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <memory>
 #include <variant>
-#include <boost/circular_buffer.hpp>
 #include <boost/intrusive/list.hpp>
 
 #include "../../asio_udp.h"
 #include "../quic_connection_id.h"
+#include "datagram_state.h"
+#include "incoming_stream_queue.h"
+#include "memory_budget.h"
 #include "stream_impl.h"
 
 struct lsquic_conn;
@@ -14,7 +17,10 @@ namespace quic::detail
 {
 
 	struct accept_operation;
+	struct datagram_operation;
+	struct readable_operation;
 	struct stream_accept_operation;
+	struct stream_accept_batch_operation;
 	struct stream_connect_operation;
 
 	using stream_list = boost::intrusive::list<stream_impl>;
@@ -42,12 +48,14 @@ namespace quic::detail
 	struct incoming_connection : connection_context
 	{
 		lsquic_conn* handle;
-		boost::circular_buffer<lsquic_stream*> incoming_streams; // TODO: allocator
+		incoming_stream_queue incoming_streams;
+		memory_charge charge; // carried over once accepted
 
-		incoming_connection(lsquic_conn* handle, uint32_t max_streams)
+		incoming_connection(lsquic_conn* handle, uint32_t max_streams, memory_charge&& charge)
 			: connection_context(true),
 			  handle(handle),
-			  incoming_streams(max_streams)
+			  incoming_streams(max_streams),
+			  charge(std::move(charge))
 		{
 		}
 	};
@@ -55,6 +63,27 @@ namespace quic::detail
 	namespace connection_state
 	{
 
+		// streams that became readable since the last async_wait_readable()
+		struct readable_streams
+		{
+			bool watching = false; // streams are watched once anyone waits
+			bool flushing = false; // queued on engine_impl::flush_connections
+			std::vector<stream_id> ready;
+			readable_operation* op = nullptr;
+		};
+
+		// one async_accept_some() spread over the streams it was given. they
+		// wait in accepting_streams without an op of their own, and the batch
+		// completes once per engine pass with however many were accepted. the
+		// op's stream pointers aren't used after it starts waiting, since a
+		// member may be destroyed meanwhile; accepting_streams tracks them
+		struct accept_batch
+		{
+			stream_accept_batch_operation* op = nullptr;
+			size_t accepted = 0;
+			bool flushing = false; // queued on engine_impl::flush_connections
+		};
+
 		struct accepting
 		{
 			accept_operation* op = nullptr;
@@ -63,15 +92,19 @@ namespace quic::detail
 		struct open
 		{
 			lsquic_conn& handle;
-			boost::circular_buffer<lsquic_stream*> incoming_streams;
+			incoming_stream_queue incoming_streams;
 			stream_list connecting_streams;
 			stream_list accepting_streams;
 			stream_list open_streams;
 			stream_list closing_streams;
+			std::unique_ptr<datagram_state::queues> datagrams; // on first use
+			readable_streams readable;
+			accept_batch batch;
+			memory_charge charge; // against the engine's memory budget
 			error_code ec;
 
-			explicit open(lsquic_conn& handle) noexcept
-				: handle(handle)
+			open(lsquic_conn& handle, memory_charge&& charge) noexcept
+				: handle(handle), charge(std::move(charge))
 			{
 			}
 		};
@@ -81,10 +114,13 @@ namespace quic::detail
 			lsquic_conn& handle;
 			stream_list open_streams;
 			stream_list closing_streams;
+			std::unique_ptr<datagram_state::queues> datagrams;
+			readable_streams readable;
+			memory_charge charge;
 			error_code ec;
 
-			explicit going_away(lsquic_conn& handle) noexcept
-				: handle(handle)
+			going_away(lsquic_conn& handle, memory_charge&& charge) noexcept
+				: handle(handle), charge(std::move(charge))
 			{
 			}
 		};
@@ -116,17 +152,36 @@ namespace quic::detail
 		connection_id id(const variant& state, error_code& ec);
 		udp::endpoint remote_endpoint(const variant& state, error_code& ec);
 
-		void on_connect(variant& state, lsquic_conn* handle);
+		void on_connect(variant& state, lsquic_conn* handle, memory_charge&& charge);
 		void on_handshake(variant& state, int status);
 		void accept(variant& state, accept_operation& op);
 		void accept_incoming(variant& state, incoming_connection&& incoming);
-		void on_accept(variant& state, lsquic_conn* handle);
+		void on_accept(variant& state, lsquic_conn* handle, memory_charge&& charge);
 
 		bool stream_connect(variant& state, stream_connect_operation& op);
 		stream_impl* on_stream_connect(variant& state, lsquic_stream* handle, bool is_http);
 
-		void stream_accept(variant& state, stream_accept_operation& op, bool is_http);
-		stream_impl* on_stream_accept(variant& state, lsquic_stream* handle, bool is_http);
+		bool stream_accept(variant& state, stream_accept_operation& op, bool is_http);
+		bool stream_accept_batch(variant& state, stream_accept_batch_operation& op, bool is_http);
+		// sets flush when a batch member was accepted and needs flush_accept_batch()
+		stream_impl* on_stream_accept(variant& state, lsquic_stream* handle, bool is_http, bool& flush);
+		void flush_accept_batch(variant& state);
+		// an accepting stream was reset or destroyed before it was accepted
+		void on_accepting_stream_closed(variant& state, stream_impl& s);
+
+		bool send_datagram(variant& state, datagram_operation& op);
+		ssize_t on_datagram_write(variant& state, void* buf, size_t size);
+		void receive_datagram(variant& state, datagram_operation& op);
+		void on_datagram(variant& state, const void* buf, size_t size);
+		void set_datagram_queue_size(variant& state, size_t size, error_code& ec);
+		datagram_stats get_datagram_stats(const variant& state, error_code& ec);
+
+		// heap bytes owned by the state, beyond the variant itself
+		size_t memory_usage(const variant& state);
+
+		bool wait_readable(variant& state, readable_operation& op);
+		bool on_stream_readable(variant& state, stream_id id);
+		void flush_readable(variant& state);
 
 		transition goaway(variant& state, error_code& ec);
 		transition on_remote_goaway(variant& state);
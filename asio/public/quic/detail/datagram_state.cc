@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <lsquic.h>
+
+#include "datagram_state.h"
+#include "operation.h"
+
+namespace quic::detail::datagram_state
+{
+
+	static size_t buffer_size(const datagram_operation& op)
+	{
+		size_t bytes = 0;
+		for (uint16_t i = 0; i < op.num_iovs; i++)
+		{
+			bytes += op.iovs[i].iov_len;
+		}
+		return bytes;
+	}
+
+	// copy as much of the datagram as fits. a short buffer truncates it
+	static size_t copy(datagram_operation& op, const char* data, size_t size, error_code& ec)
+	{
+		size_t copied = 0;
+		for (uint16_t i = 0; i < op.num_iovs && copied < size; i++)
+		{
+			const size_t n = std::min(op.iovs[i].iov_len, size - copied);
+			::memcpy(op.iovs[i].iov_base, data + copied, n);
+			copied += n;
+		}
+		ec = error_code{};
+		if (copied < size)
+		{
+			ec = make_error_code(errc::message_size);
+		}
+		return copied;
+	}
+
+	// drop the oldest datagram, giving back its charge
+	static void pop_front(queues& q, std::deque<std::vector<char>>& d)
+	{
+		q.charge.shrink(d.front().size());
+		d.pop_front();
+	}
+
+	static void clear(queues& q, std::deque<std::vector<char>>& d)
+	{
+		while (!d.empty())
+		{
+			pop_front(q, d);
+		}
+	}
+
+	// lsquic pads packets to make room for the minimum datagram size, so
+	// lower it again once the datagrams that needed more are gone
+	static void fit_min_size(const queues& q, lsquic_conn* handle)
+	{
+		size_t largest = 0;
+		for (const auto& datagram : q.outgoing)
+		{
+			largest = std::max(largest, datagram.size());
+		}
+		if (largest < ::lsquic_conn_get_min_datagram_size(handle))
+		{
+			::lsquic_conn_set_min_datagram_size(handle, largest);
+		}
+	}
+
+	bool send(queues& q, lsquic_conn* handle, datagram_operation& op)
+	{
+		const size_t size = buffer_size(op);
+		// fails unless both sides enabled datagrams in their settings
+		if (::lsquic_conn_want_datagram_write(handle, 1) == -1)
+		{
+			op.post(make_error_code(errc::operation_not_supported), 0);
+			return false;
+		}
+		// make lsquic reserve room for the largest queued datagram. it refuses
+		// sizes that can't fit in a packet
+		if (size > ::lsquic_conn_get_min_datagram_size(handle) &&
+			::lsquic_conn_set_min_datagram_size(handle, size) == -1)
+		{
+			q.stats.oversized++;
+			if (q.outgoing.empty())
+			{
+				::lsquic_conn_want_datagram_write(handle, 0);
+			}
+			op.post(make_error_code(errc::message_size), 0);
+			return false;
+		}
+
+		if (!q.charge.try_grow(size))
+		{
+			fit_min_size(q, handle);
+			if (q.outgoing.empty())
+			{
+				::lsquic_conn_want_datagram_write(handle, 0);
+			}
+			op.post(make_error_code(errc::no_buffer_space), 0);
+			return false;
+		}
+		// drop the oldest only once this one is sure to be queued
+		if (q.outgoing.size() >= q.limit)
+		{
+			pop_front(q, q.outgoing);
+			q.stats.dropped_outgoing++;
+		}
+		auto& datagram = q.outgoing.emplace_back();
+		datagram.reserve(size);
+		for (uint16_t i = 0; i < op.num_iovs; i++)
+		{
+			const auto p = static_cast<const char*>(op.iovs[i].iov_base);
+			datagram.insert(datagram.end(), p, p + op.iovs[i].iov_len);
+		}
+		op.post(error_code{}, size);
+		return true;
+	}
+
+	ssize_t on_write(queues& q, lsquic_conn* handle, void* buf, size_t size)
+	{
+		while (!q.outgoing.empty() && q.outgoing.front().size() > size)
+		{
+			pop_front(q, q.outgoing);
+			q.stats.oversized++;
+		}
+		if (q.outgoing.empty())
+		{
+			fit_min_size(q, handle);
+			::lsquic_conn_want_datagram_write(handle, 0);
+			return -1;
+		}
+		auto& datagram = q.outgoing.front();
+		const auto bytes = static_cast<ssize_t>(datagram.size());
+		::memcpy(buf, datagram.data(), datagram.size());
+		pop_front(q, q.outgoing);
+		q.stats.sent++;
+		fit_min_size(q, handle);
+		if (q.outgoing.empty())
+		{
+			::lsquic_conn_want_datagram_write(handle, 0);
+		}
+		return bytes;
+	}
+
+	void receive(queues& q, datagram_operation& op)
+	{
+		if (q.receiving)
+		{
+			op.post(make_error_code(errc::invalid_argument), 0);
+			return;
+		}
+		if (q.incoming.empty())
+		{
+			q.receiving = &op;
+			return;
+		}
+		auto& datagram = q.incoming.front();
+		error_code ec;
+		const size_t bytes = copy(op, datagram.data(), datagram.size(), ec);
+		pop_front(q, q.incoming);
+		op.post(ec, bytes);
+	}
+
+	void on_receive(queues& q, const void* buf, size_t size)
+	{
+		q.stats.received++;
+		const auto p = static_cast<const char*>(buf);
+		if (q.receiving)
+		{
+			auto& op = *std::exchange(q.receiving, nullptr);
+			error_code ec;
+			const size_t bytes = copy(op, p, size, ec);
+			op.defer(ec, bytes);
+			return;
+		}
+		if (q.incoming.size() >= q.limit)
+		{
+			pop_front(q, q.incoming);
+			q.stats.dropped_incoming++;
+		}
+		if (!q.charge.try_grow(size))
+		{
+			q.stats.dropped_incoming++; // over the memory budget
+			return;
+		}
+		q.incoming.emplace_back(p, p + size);
+	}
+
+	void set_limit(queues& q, size_t limit)
+	{
+		q.limit = limit;
+		while (q.outgoing.size() > limit)
+		{
+			pop_front(q, q.outgoing);
+			q.stats.dropped_outgoing++;
+		}
+		while (q.incoming.size() > limit)
+		{
+			pop_front(q, q.incoming);
+			q.stats.dropped_incoming++;
+		}
+	}
+
+	int cancel(queues& q, error_code ec)
+	{
+		clear(q, q.outgoing);
+		clear(q, q.incoming);
+		if (auto op = std::exchange(q.receiving, nullptr); op)
+		{
+			op->defer(ec, 0);
+			return 1;
+		}
+		return 0;
+	}
+
+	void destroy(queues& q)
+	{
+		if (auto op = std::exchange(q.receiving, nullptr); op)
+		{
+			op->destroy(error_code{}, 0);
+		}
+	}
+
+	// how a deque allocates is up to the standard library, so this is an
+	// estimate: each element and a map pointer to it, plus every datagram's
+	// capacity. a library's block rounding isn't included
+	static size_t memory_usage(const std::deque<std::vector<char>>& d)
+	{
+		size_t bytes = d.size() * (sizeof(std::vector<char>) + sizeof(void*));
+		for (const auto& datagram : d)
+		{
+			bytes += datagram.capacity();
+		}
+		return bytes;
+	}
+
+	size_t memory_usage(const queues& q)
+	{
+		return sizeof(q) + memory_usage(q.outgoing) + memory_usage(q.incoming);
+	}
+
+} // namespace quic::detail::datagram_state
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+
+#include "../../asio_error_code.h"
+#include "../quic_datagram.h"
+#include "memory_budget.h"
+
+struct lsquic_conn;
+
+namespace quic::detail
+{
+
+	struct datagram_operation;
+
+	namespace datagram_state
+	{
+
+		// datagrams waiting on either side of lsquic. both queues are bounded,
+		// and a full queue drops its oldest entry to make room. queued bytes
+		// are charged to the engine's memory budget
+		struct queues
+		{
+			static constexpr size_t default_limit = 64;
+			std::deque<std::vector<char>> outgoing;
+			std::deque<std::vector<char>> incoming;
+			size_t limit = default_limit;
+			datagram_operation* receiving = nullptr;
+			datagram_stats stats;
+			memory_charge charge;
+		};
+
+		bool send(queues& q, lsquic_conn* handle, datagram_operation& op);
+		ssize_t on_write(queues& q, lsquic_conn* handle, void* buf, size_t size);
+
+		void receive(queues& q, datagram_operation& op);
+		void on_receive(queues& q, const void* buf, size_t size);
+
+		void set_limit(queues& q, size_t limit);
+
+		int cancel(queues& q, error_code ec);
+		void destroy(queues& q);
+
+		// bytes allocated for the queues, including the object itself
+		size_t memory_usage(const queues& q);
+
+	} // namespace datagram_state
+
+} // namespace quic::detail
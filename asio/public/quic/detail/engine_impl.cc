@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <lsquic.h>
 #include <lsxpack_header.h>
 
@@ -42,14 +43,32 @@ namespace quic::detail
 		process(lock);
 	}
 
-	void engine_impl::process(std::unique_lock<std::mutex>& lock)
+	quic::memory_stats engine_impl::memory_stats() const
 	{
-		::lsquic_engine_process_conns(handle.get());
+		auto lock = std::unique_lock{ mutex };
+		return { budget.limit, budget.used, budget.pressure() };
+	}
+
+	void engine_impl::process(std::unique_lock<engine_mutex>& lock)
+	{
+		{
+			auto scope = completion_batch_scope{ mutex.completions };
+			::lsquic_engine_process_conns(handle.get());
+			// complete each connection's async_wait_readable() and
+			// async_accept_some() once, with everything lsquic reported in this pass
+			while (!flush_connections.empty())
+			{
+				auto c = flush_connections.back();
+				flush_connections.pop_back();
+				c->flush();
+			}
+		}
 		reschedule(lock);
 	}
 
-	void engine_impl::reschedule(std::unique_lock<std::mutex>& lock)
+	void engine_impl::reschedule(std::unique_lock<engine_mutex>& lock)
 	{
+		auto expiry = deadlines.next_expiry();
 		int micros = 0;
 		if (!::lsquic_engine_earliest_adv_tick(handle.get(), &micros))
 		{
@@ -58,16 +77,26 @@ namespace quic::detail
 				client->receiving = false;
 				client->socket.cancel();
 			}
-			timer.cancel();
-			return;
+			if (!expiry)
+			{
+				timer.cancel();
+				return;
+			}
 		}
-		if (micros <= 0)
+		else if (micros <= 0)
 		{
 			process(lock);
 			return;
 		}
-		const auto dur = std::chrono::microseconds{ micros };
-		timer.expires_after(dur);
+		else
+		{
+			const auto tick = deadline_clock::now() + std::chrono::microseconds{ micros };
+			if (!expiry || tick < *expiry)
+			{
+				expiry = tick;
+			}
+		}
+		timer.expires_at(*expiry);
 		timer.async_wait([this](error_code ec)
 		{
 			if (!ec)
@@ -80,6 +109,10 @@ namespace quic::detail
 	void engine_impl::on_timer()
 	{
 		auto lock = std::unique_lock{ mutex };
+		{
+			auto scope = completion_batch_scope{ mutex.completions };
+			deadlines.advance(deadline_clock::now());
+		}
 		process(lock);
 	}
 
@@ -140,6 +173,11 @@ namespace quic::detail
 		{
 			auto c = static_cast<incoming_connection*>(ctx);
 			assert(!c->incoming_streams.full());
+			if (estate->budget.pressure())
+			{
+				::lsquic_stream_close(stream);
+				return nullptr;
+			}
 			c->incoming_streams.push_back(stream);
 			return nullptr;
 		}
@@ -218,6 +256,29 @@ namespace quic::detail
 		c->on_remote_close(app_error, code);
 	}
 
+	static ssize_t on_dg_write(lsquic_conn_t* conn, void* buf, size_t size)
+	{
+		auto ctx = reinterpret_cast<connection_context*>(::lsquic_conn_get_ctx(conn));
+		if (!ctx || ctx->incoming)
+		{
+			::lsquic_conn_want_datagram_write(conn, 0);
+			return -1;
+		}
+		auto c = static_cast<connection_impl*>(ctx);
+		return c->on_datagram_write(buf, size);
+	}
+
+	static void on_datagram(lsquic_conn_t* conn, const void* buf, size_t size)
+	{
+		auto ctx = reinterpret_cast<connection_context*>(::lsquic_conn_get_ctx(conn));
+		if (!ctx || ctx->incoming)
+		{
+			return; // not accepted yet
+		}
+		auto c = static_cast<connection_impl*>(ctx);
+		c->on_datagram(buf, size);
+	}
+
 	static constexpr lsquic_stream_if make_stream_api()
 	{
 		lsquic_stream_if api = {};
@@ -230,6 +291,8 @@ namespace quic::detail
 		api.on_hsk_done = on_hsk_done;
 		api.on_goaway_received = on_goaway_received;
 		api.on_conncloseframe_received = on_conncloseframe_received;
+		api.on_dg_write = on_dg_write;
+		api.on_datagram = on_datagram;
 		return api;
 	}
 
@@ -334,6 +397,9 @@ namespace quic::detail
 		api.ea_settings = &es;
 
 		max_streams_per_connection = es.es_init_max_streams_bidi;
+		// auto-tuning may grow a connection's window up to es_max_cfcw
+		connection_window = std::max(es.es_init_max_data, es.es_max_cfcw);
+		budget.limit = s ? s->memory_budget : 0;
 
 		handle.reset(::lsquic_engine_new(flags, &api));
 	}
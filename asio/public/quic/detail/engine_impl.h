@@ -2,10 +2,14 @@
 
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include <boost/asio/steady_timer.hpp>
 
 #include "../quic_settings.h"
+#include "completion_batch.h"
+#include "memory_budget.h"
+#include "timer_wheel.h"
 
 struct lsquic_engine;
 struct lsquic_conn;
@@ -25,18 +29,54 @@ namespace quic::detail
 	};
 	using lsquic_engine_ptr = std::unique_ptr<lsquic_engine, engine_deleter>;
 
+	// the engine's mutex. completions defer()red under it are batched, and
+	// whichever unlock() finally releases it runs them, so nothing changes
+	// hands while a caller of process() or reschedule() holds the lock
+	class engine_mutex
+	{
+		std::mutex m;
+	public:
+		completion_batch completions;
+
+		void lock()
+		{
+			m.lock();
+		}
+		bool try_lock()
+		{
+			return m.try_lock();
+		}
+		void unlock()
+		{
+			auto batch = completions.release();
+			m.unlock();
+			completion_batch::run(batch); // may destroy the engine
+		}
+	};
+
 	struct engine_impl
 	{
-		mutable std::mutex mutex;
+		mutable engine_mutex mutex;
 		boost::asio::any_io_executor ex;
 		boost::asio::steady_timer timer;
 		lsquic_engine_ptr handle;
 		socket_impl* client;
 		uint32_t max_streams_per_connection;
 		bool is_http;
+		// connections with completions batched during this process(), like
+		// streams that became readable or were accepted into a batch
+		std::vector<connection_impl*> flush_connections;
+		// per-operation deadlines, checked whenever the engine timer fires
+		timer_wheel deadlines;
+		// settings::memory_budget. each connection is charged connection_window,
+		// the most its flow control window can grow to
+		memory_budget budget;
+		uint32_t connection_window;
 
-		void process(std::unique_lock<std::mutex>& lock);
-		void reschedule(std::unique_lock<std::mutex>& lock);
+		// both run with the caller's lock held throughout. completions
+		// from lsquic callbacks wait in mutex.completions for its unlock()
+		void process(std::unique_lock<engine_mutex>& lock);
+		void reschedule(std::unique_lock<engine_mutex>& lock);
 		void on_timer();
 
 		engine_impl(const boost::asio::any_io_executor& ex, socket_impl* client, const settings* s, unsigned flags);
@@ -50,6 +90,8 @@ namespace quic::detail
 
 		void close();
 
+		quic::memory_stats memory_stats() const;
+
 		int send_packets(const lsquic_out_spec* specs, unsigned n_specs);
 
 		stream_impl* on_new_stream(connection_impl& c, lsquic_stream* stream);
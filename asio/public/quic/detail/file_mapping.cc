@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_mapping.h"
+
+namespace quic::detail
+{
+
+	file_mapping::file_mapping(int fd, off_t offset, size_t length, error_code& ec)
+	{
+		// pages past the end of the file raise SIGBUS when lsquic reads them,
+		// so the whole range has to exist before it's mapped
+		struct stat st;
+		if (::fstat(fd, &st) == -1)
+		{
+			ec.assign(errno, system_category());
+			return;
+		}
+		if (offset < 0 || offset > st.st_size ||
+			length > static_cast<size_t>(st.st_size - offset))
+		{
+			ec = make_error_code(errc::invalid_argument);
+			return;
+		}
+		if (length == 0)
+		{
+			ec = error_code{};
+			return;
+		}
+		const auto page_size = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+		const off_t aligned = offset - offset % page_size;
+		skew = static_cast<size_t>(offset - aligned);
+
+		void* p = ::mmap(nullptr, skew + length, PROT_READ, MAP_SHARED, fd, aligned);
+		if (p == MAP_FAILED)
+		{
+			ec.assign(errno, system_category());
+			skew = 0;
+			return;
+		}
+		addr = p;
+		mapped = skew + length;
+		// pages are consumed front to back as lsquic packetizes them
+		::madvise(addr, mapped, MADV_SEQUENTIAL);
+		ec = error_code{};
+	}
+
+	file_mapping::~file_mapping()
+	{
+		if (addr)
+		{
+			::munmap(addr, mapped);
+		}
+	}
+
+	file_mapping::file_mapping(file_mapping&& o) noexcept
+		: addr(std::exchange(o.addr, nullptr)),
+		  mapped(std::exchange(o.mapped, 0)),
+		  skew(std::exchange(o.skew, 0))
+	{
+	}
+
+	file_mapping& file_mapping::operator=(file_mapping&& o) noexcept
+	{
+		std::swap(addr, o.addr);
+		std::swap(mapped, o.mapped);
+		std::swap(skew, o.skew);
+		return *this;
+	}
+
+	void file_mapping::will_need(size_t offset, size_t length) const
+	{
+		if (!addr || offset >= size())
+		{
+			return;
+		}
+		const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		const size_t begin = skew + offset;
+		const size_t aligned = begin - begin % page_size;
+		const size_t end = std::min(skew + offset + length, mapped);
+		::madvise(static_cast<char*>(addr) + aligned, end - aligned, MADV_WILLNEED);
+	}
+
+} // namespace quic::detail
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/types.h>
+
+#include "../../asio_error_code.h"
+
+namespace quic::detail
+{
+
+	/// read-only memory mapping of a file range. the mapping starts at the page
+	/// boundary below the requested offset, and data() skips over that skew
+	class file_mapping
+	{
+		void* addr = nullptr;
+		size_t mapped = 0;
+		size_t skew = 0;
+	public:
+		file_mapping() = default;
+		file_mapping(int fd, off_t offset, size_t length, error_code& ec);
+		~file_mapping();
+
+		file_mapping(file_mapping&& o) noexcept;
+		file_mapping& operator=(file_mapping&& o) noexcept;
+
+		const void* data() const
+		{
+			return static_cast<const char*>(addr) + skew;
+		}
+		size_t size() const
+		{
+			return mapped - skew;
+		}
+
+		/// hint that [offset, offset+length) of the range will be read soon
+		void will_need(size_t offset, size_t length) const;
+	};
+
+} // namespace quic::detail
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#include "incoming_stream_queue.h"
+
+namespace quic::detail
+{
+
+	namespace
+	{
+
+		// freed arrays of each power-of-two size, linked through their first
+		// slot. a handful per size covers connections churning on a thread
+		// without holding on to a burst's worth of memory. it's never given
+		// back or charged to the memory budget, so only small arrays are kept,
+		// at most 64 * 2 KiB of the largest and under 256 KiB in all
+		class slot_pool
+		{
+			static constexpr unsigned min_shift = 2;
+			static constexpr unsigned max_shift = 8; // larger arrays aren't pooled
+			static constexpr size_t max_free = 64;
+
+			struct free_list
+			{
+				void* head = nullptr;
+				size_t count = 0;
+			};
+			std::array<free_list, max_shift + 1> lists;
+
+			slot_pool() = default;
+		public:
+			static constexpr uint32_t min_capacity = uint32_t{ 1 } << min_shift;
+
+			~slot_pool()
+			{
+				for (auto& l : lists)
+				{
+					while (l.head)
+					{
+						auto p = l.head;
+						l.head = *static_cast<void**>(p);
+						::operator delete(p);
+					}
+				}
+			}
+
+			static slot_pool& local()
+			{
+				thread_local slot_pool pool;
+				return pool;
+			}
+
+			lsquic_stream** allocate(uint32_t capacity)
+			{
+				const auto shift = static_cast<unsigned>(std::countr_zero(capacity));
+				if (shift <= max_shift && lists[shift].head)
+				{
+					auto& l = lists[shift];
+					auto p = l.head;
+					l.head = *static_cast<void**>(p);
+					l.count--;
+					return static_cast<lsquic_stream**>(p);
+				}
+				return static_cast<lsquic_stream**>(::operator new(capacity * sizeof(lsquic_stream*)));
+			}
+
+			void deallocate(lsquic_stream** slots, uint32_t capacity)
+			{
+				const auto shift = static_cast<unsigned>(std::countr_zero(capacity));
+				if (shift > max_shift || lists[shift].count >= max_free)
+				{
+					::operator delete(slots);
+					return;
+				}
+				auto& l = lists[shift];
+				*reinterpret_cast<void**>(slots) = l.head;
+				l.head = slots;
+				l.count++;
+			}
+		};
+
+	} // anonymous namespace
+
+	incoming_stream_queue::incoming_stream_queue(incoming_stream_queue&& other) noexcept
+		: slots(std::exchange(other.slots, nullptr)),
+		  capacity(std::exchange(other.capacity, 0)),
+		  head(std::exchange(other.head, 0)),
+		  count(std::exchange(other.count, 0)),
+		  limit(other.limit)
+	{
+	}
+
+	incoming_stream_queue& incoming_stream_queue::operator=(incoming_stream_queue&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			slots = std::exchange(other.slots, nullptr);
+			capacity = std::exchange(other.capacity, 0);
+			head = std::exchange(other.head, 0);
+			count = std::exchange(other.count, 0);
+			limit = other.limit;
+		}
+		return *this;
+	}
+
+	void incoming_stream_queue::grow()
+	{
+		const uint32_t new_capacity = capacity ? capacity * 2 : slot_pool::min_capacity;
+		auto& pool = slot_pool::local();
+		auto new_slots = pool.allocate(new_capacity);
+		// unwrap the ring into the front of the new array
+		const uint32_t first = std::min(count, capacity - head);
+		if (count)
+		{
+			::memcpy(new_slots, slots + head, first * sizeof(lsquic_stream*));
+			::memcpy(new_slots + first, slots, (count - first) * sizeof(lsquic_stream*));
+			pool.deallocate(slots, capacity);
+		}
+		slots = new_slots;
+		capacity = new_capacity;
+		head = 0;
+	}
+
+	void incoming_stream_queue::release()
+	{
+		if (slots)
+		{
+			slot_pool::local().deallocate(slots, capacity);
+			slots = nullptr;
+			capacity = 0;
+		}
+		head = 0;
+	}
+
+} // namespace quic::detail
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct lsquic_stream;
+
+namespace quic::detail
+{
+
+	// incoming streams waiting for accept(), up to a fixed limit. storage
+	// is allocated on the first push, doubles as needed, and is given back
+	// once the queue drains, so an idle connection costs just this object.
+	// arrays come from per-thread free lists of power-of-two sizes
+	class incoming_stream_queue
+	{
+		lsquic_stream** slots = nullptr;
+		uint32_t capacity = 0; // a power of two, or 0 without storage
+		uint32_t head = 0;
+		uint32_t count = 0;
+		uint32_t limit = 0;
+
+		void grow();
+		void release();
+	public:
+		explicit incoming_stream_queue(uint32_t limit = 0) noexcept
+			: limit(limit)
+		{
+		}
+		~incoming_stream_queue()
+		{
+			release();
+		}
+
+		incoming_stream_queue(incoming_stream_queue&& other) noexcept;
+		incoming_stream_queue& operator=(incoming_stream_queue&& other) noexcept;
+
+		bool empty() const
+		{
+			return count == 0;
+		}
+		bool full() const
+		{
+			return count >= limit;
+		}
+		size_t size() const
+		{
+			return count;
+		}
+
+		// heap bytes held by the queue
+		size_t memory_usage() const
+		{
+			return capacity * sizeof(lsquic_stream*);
+		}
+
+		void push_back(lsquic_stream* stream)
+		{
+			if (count == capacity)
+			{
+				grow();
+			}
+			slots[(head + count) & (capacity - 1)] = stream;
+			count++;
+		}
+
+		lsquic_stream* front() const
+		{
+			return slots[head];
+		}
+
+		void pop_front()
+		{
+			head = (head + 1) & (capacity - 1);
+			if (--count == 0)
+			{
+				release();
+			}
+		}
+	};
+
+} // namespace quic::detail
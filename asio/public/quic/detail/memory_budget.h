@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace quic::detail
+{
+
+	// an engine-wide limit on the memory held for its connections: the
+	// receive buffering each connection's flow control window lets lsquic
+	// commit, plus read-ahead buffers and datagram queues. guarded by the
+	// engine mutex
+	struct memory_budget
+	{
+		size_t limit = 0; // 0 for unlimited
+		size_t used = 0;
+
+		// past 7/8 of the limit, new connections and streams are refused
+		bool pressure() const
+		{
+			return limit && used >= limit - limit / 8;
+		}
+
+		bool try_reserve(size_t bytes)
+		{
+			if (limit && bytes > limit - std::min(used, limit))
+			{
+				return false;
+			}
+			used += bytes;
+			return true;
+		}
+	};
+
+	// bytes held against a budget, given back on destruction
+	class memory_charge
+	{
+		memory_budget* budget_ = nullptr;
+		size_t bytes = 0;
+	public:
+		memory_charge() = default;
+		explicit memory_charge(memory_budget& budget) noexcept
+			: budget_(&budget)
+		{
+		}
+
+		memory_charge(memory_charge&& other) noexcept
+			: budget_(std::exchange(other.budget_, nullptr)),
+			  bytes(std::exchange(other.bytes, 0))
+		{
+		}
+
+		memory_charge& operator=(memory_charge&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				budget_ = std::exchange(other.budget_, nullptr);
+				bytes = std::exchange(other.bytes, 0);
+			}
+			return *this;
+		}
+
+		~memory_charge()
+		{
+			reset();
+		}
+
+		memory_budget* budget() const
+		{
+			return budget_;
+		}
+
+		size_t size() const
+		{
+			return bytes;
+		}
+
+		// add to the charge, unless the budget can't cover it
+		bool try_grow(size_t n)
+		{
+			if (budget_ && !budget_->try_reserve(n))
+			{
+				return false;
+			}
+			bytes += n;
+			return true;
+		}
+
+		// add to the charge even past the limit
+		void grow(size_t n)
+		{
+			if (budget_)
+			{
+				budget_->used += n;
+			}
+			bytes += n;
+		}
+
+		void shrink(size_t n)
+		{
+			if (budget_)
+			{
+				budget_->used -= n;
+			}
+			bytes -= n;
+		}
+
+		void reset()
+		{
+			shrink(bytes);
+		}
+	};
+
+} // namespace quic::detail
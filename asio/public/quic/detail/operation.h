@@ -1,14 +1,19 @@
 #pragma once
 
-#include <condition_variable>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <mutex>
 #include <optional>
+#include <thread>
+#include <vector>
 #include <sys/uio.h>
 #include <boost/asio/associated_executor.hpp>
 
 #include "../../asio_error_code.h"
 #include "../../h3/h3_fields.h"
+#include "../quic_stream_id.h"
+#include "completion_batch.h"
+#include "file_mapping.h"
 #include "handler_ptr.h"
 
 namespace quic::detail
@@ -18,11 +23,13 @@ namespace quic::detail
 
 	enum class completion_type
 	{
-		post, defer, dispatch, destroy
+		post, defer, dispatch, destroy,
+		queue, // a defer() under a completion_batch. keep the result and push()
+		deferred, // a queued completion, run by the batch after the engine unlocked
 	};
 
 	template<typename ...Args>
-	struct operation
+	struct operation : deferred_completion
 	{
 		using operation_type = operation<Args...>;
 		using tuple_type = std::tuple<Args...>;
@@ -43,6 +50,11 @@ namespace quic::detail
 		template<typename ...UArgs>
 		void defer(UArgs&& ...args)
 		{
+			if (completion_batch::current)
+			{
+				complete_(completion_type::queue, this, tuple_type{ std::forward<UArgs>(args)... });
+				return;
+			}
 			complete_(completion_type::defer, this, tuple_type{ std::forward<UArgs>(args)... });
 		}
 		template<typename ...UArgs>
@@ -57,15 +69,22 @@ namespace quic::detail
 		}
 	};
 
+	// blocks the calling thread on a single atomic (a futex on linux) instead
+	// of a mutex and condition variable. the completion stores the result,
+	// publishes `ready`, wakes the waiter, then publishes `done`. the waiter
+	// only returns after `done` so the completion never touches a destroyed op
 	template<typename Operation>
 	struct sync_operation : Operation
 	{
-		std::mutex mutex;
-		std::condition_variable cond;
 		using operation_type = typename Operation::operation_type;
 		using tuple_type = typename Operation::tuple_type;
+
+		enum : uint8_t { pending, ready, done };
+		std::atomic<uint8_t> state = pending;
 		std::optional<tuple_type> result;
 
+		static constexpr int spin_count = 64; // before sleeping in wait()
+
 		template<typename ...Args>
 		explicit sync_operation(Args&& ...args)
 			: Operation(do_complete, std::forward<Args>(args)...)
@@ -76,18 +95,41 @@ namespace quic::detail
 			tuple_type&& result)
 		{
 			auto self = static_cast<sync_operation*>(op);
-			if (type != completion_type::destroy)
+			if (type == completion_type::queue)
+			{
+				self->result = std::move(result);
+				completion_batch::current->push(*self, publish);
+			}
+			else if (type != completion_type::destroy)
 			{
-				auto lock = std::scoped_lock{ self->mutex };
 				self->result = std::move(result);
-				self->cond.notify_one();
+				self->publish();
 			}
 		}
+		static void publish(deferred_completion* c)
+		{
+			static_cast<sync_operation*>(c)->publish();
+		}
+		void publish()
+		{
+			state.store(ready, std::memory_order_release);
+			state.notify_one();
+			state.store(done, std::memory_order_release);
+		}
 		void wait()
 		{
-			auto lock = std::unique_lock{ mutex };
-			cond.wait(lock, [this]
-			{ return result.has_value(); });
+			for (int i = 0; i < spin_count; ++i)
+			{
+				if (state.load(std::memory_order_acquire) == done)
+				{
+					return;
+				}
+			}
+			state.wait(pending, std::memory_order_acquire);
+			while (state.load(std::memory_order_acquire) != done)
+			{
+				std::this_thread::yield(); // between notify_one() and the final store
+			}
 		}
 	};
 
@@ -104,6 +146,7 @@ namespace quic::detail
 														   boost::asio::execution::outstanding_work_t::tracked_t>::type;
 		Handler handler;
 		std::pair<Work, IoWork> ex;
+		std::optional<tuple_type> queued; // the result while on a completion_batch
 
 		template<typename ...Args>
 		async_operation(Handler&& handler, const IoExecutor& io_ex, Args&& ...args)
@@ -115,9 +158,22 @@ namespace quic::detail
 		{
 		}
 
+		static void run_queued(deferred_completion* c)
+		{
+			auto self = static_cast<async_operation*>(c);
+			auto args = std::move(*self->queued);
+			do_complete(completion_type::deferred, self, std::move(args));
+		}
+
 		static void do_complete(completion_type type, operation_type* op, tuple_type&& args)
 		{
 			auto self = static_cast<async_operation*>(op);
+			if (type == completion_type::queue)
+			{
+				self->queued = std::move(args);
+				completion_batch::current->push(*self, run_queued);
+				return;
+			}
 			auto p = handler_ptr<async_operation, Handler>{ self, &self->handler };
 
 			auto handler = std::move(self->handler); // may throw
@@ -144,6 +200,7 @@ namespace quic::detail
 					std::move(f));
 				break;
 			case completion_type::defer:
+			case completion_type::deferred:
 				boost::asio::execution::execute(
 					boost::asio::require(
 						boost::asio::prefer(ex,
@@ -159,7 +216,8 @@ namespace quic::detail
 						boost::asio::execution::allocator(alloc)),
 					std::move(f));
 				break;
-			case completion_type::destroy: // handled above
+			case completion_type::queue: // handled above
+			case completion_type::destroy:
 				break;
 			}
 		}
@@ -192,6 +250,22 @@ namespace quic::detail
 	using stream_connect_async = async_operation<stream_connect_operation, Handler, IoExecutor>;
 
 
+	// connection readiness
+	struct readable_operation : operation<error_code>
+	{
+		std::vector<stream_id>& ids;
+
+		readable_operation(complete_fn complete, std::vector<stream_id>& ids) noexcept
+			: operation(complete), ids(ids)
+		{
+		}
+	};
+	using readable_sync = sync_operation<readable_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using readable_async = async_operation<readable_operation, Handler, IoExecutor>;
+
+
 	// stream accept
 	struct stream_accept_operation : operation<error_code>
 	{
@@ -207,6 +281,21 @@ namespace quic::detail
 	template<typename Handler, typename IoExecutor>
 	using stream_accept_async = async_operation<stream_accept_operation, Handler, IoExecutor>;
 
+	// accept into several streams at once, completing with how many were opened
+	struct stream_accept_batch_operation : operation<error_code, size_t>
+	{
+		std::vector<stream_impl*> streams;
+
+		stream_accept_batch_operation(complete_fn complete, std::vector<stream_impl*> streams) noexcept
+			: operation(complete), streams(std::move(streams))
+		{
+		}
+	};
+	using stream_accept_batch_sync = sync_operation<stream_accept_batch_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using stream_accept_batch_async = async_operation<stream_accept_batch_operation, Handler, IoExecutor>;
+
 
 	struct stream_data_operation : operation<error_code, size_t>
 	{
@@ -214,6 +303,8 @@ namespace quic::detail
 		iovec iovs[max_iovs];
 		uint16_t num_iovs = 0;
 		size_t bytes_transferred = 0;
+		size_t minimum = 0; // read_all() completes after this much, 0 to fill the buffers
+		bool truncated = false; // the buffer sequence had more than max_iovs buffers
 
 		explicit stream_data_operation(complete_fn complete) noexcept
 			: operation(complete)
@@ -226,6 +317,159 @@ namespace quic::detail
 	using stream_data_async = async_operation<stream_data_operation, Handler, IoExecutor>;
 
 
+	// one payload written to many streams. each stream gets a fanout_part, a
+	// small operation of its own that reads from the shared payload, and the
+	// fan-out completes once every part has, with their results in order
+	struct fanout_write_operation;
+
+	struct fanout_part : operation<error_code, size_t>
+	{
+		fanout_write_operation* parent = nullptr;
+		size_t index = 0;
+		size_t bytes_transferred = 0;
+
+		fanout_part() noexcept
+			: operation(on_complete)
+		{
+		}
+
+		static void on_complete(completion_type type, operation_type* op, tuple_type&& result);
+	};
+
+	struct fanout_write_operation : operation<error_code, std::vector<error_code>>
+	{
+		std::shared_ptr<const std::vector<char>> payload;
+		std::vector<stream_impl*> streams;
+		std::unique_ptr<fanout_part[]> parts;
+		std::vector<error_code> results;
+		std::atomic<size_t> remaining;
+		std::atomic<bool> destroyed = false; // a part was destroyed on shutdown
+
+		fanout_write_operation(complete_fn complete, std::vector<stream_impl*> streams,
+			std::shared_ptr<const std::vector<char>> payload)
+			: operation(complete),
+			  payload(std::move(payload)),
+			  streams(std::move(streams)),
+			  parts(new fanout_part[this->streams.size()]),
+			  results(this->streams.size()),
+			  remaining(this->streams.size())
+		{
+			for (size_t i = 0; i < this->streams.size(); i++)
+			{
+				parts[i].parent = this;
+				parts[i].index = i;
+			}
+		}
+
+		// completes with the first failure, if any, and every stream's result
+		void finish()
+		{
+			if (destroyed.load(std::memory_order_relaxed))
+			{
+				destroy(error_code{}, std::vector<error_code>{});
+				return;
+			}
+			error_code ec;
+			for (const auto& r : results)
+			{
+				if (r)
+				{
+					ec = r;
+					break;
+				}
+			}
+			post(ec, std::move(results)); // may be under a stream's engine mutex
+		}
+	};
+
+	inline void fanout_part::on_complete(completion_type type, operation_type* op, tuple_type&& result)
+	{
+		// a part has no executor of its own, so a queued completion is
+		// recorded right away like any other
+		auto part = static_cast<fanout_part*>(op);
+		auto parent = part->parent;
+		parent->results[part->index] = std::get<0>(result);
+		if (type == completion_type::destroy)
+		{
+			parent->destroyed.store(true, std::memory_order_relaxed);
+		}
+		if (parent->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			parent->finish(); // frees every part, including this one
+		}
+	}
+
+	using fanout_write_sync = sync_operation<fanout_write_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using fanout_write_async = async_operation<fanout_write_operation, Handler, IoExecutor>;
+
+
+	// stream readiness waits carry no buffers
+	struct stream_wait_operation : operation<error_code>
+	{
+		explicit stream_wait_operation(complete_fn complete) noexcept
+			: operation(complete)
+		{
+		}
+	};
+	using stream_wait_sync = sync_operation<stream_wait_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using stream_wait_async = async_operation<stream_wait_operation, Handler, IoExecutor>;
+
+
+	// stream file sends
+	struct stream_file_operation : stream_data_operation
+	{
+		file_mapping mapping;
+
+		stream_file_operation(complete_fn complete, file_mapping&& mapping) noexcept
+			: stream_data_operation(complete), mapping(std::move(mapping))
+		{
+			iovs[0].iov_base = const_cast<void*>(this->mapping.data());
+			iovs[0].iov_len = this->mapping.size();
+			num_iovs = 1;
+		}
+	};
+	using stream_file_sync = sync_operation<stream_file_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using stream_file_async = async_operation<stream_file_operation, Handler, IoExecutor>;
+
+
+	// connection datagrams
+	struct datagram_operation : operation<error_code, size_t>
+	{
+		static constexpr uint16_t max_iovs = 16;
+		iovec iovs[max_iovs];
+		uint16_t num_iovs = 0;
+
+		explicit datagram_operation(complete_fn complete) noexcept
+			: operation(complete)
+		{
+		}
+	};
+	using datagram_sync = sync_operation<datagram_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using datagram_async = async_operation<datagram_operation, Handler, IoExecutor>;
+
+
+	// wheel_timer waits
+	struct timer_wait_operation : operation<error_code>
+	{
+		explicit timer_wait_operation(complete_fn complete) noexcept
+			: operation(complete)
+		{
+		}
+	};
+	using timer_wait_sync = sync_operation<timer_wait_operation>;
+
+	template<typename Handler, typename IoExecutor>
+	using timer_wait_async = async_operation<timer_wait_operation, Handler, IoExecutor>;
+
+
 	// stream header reads
 	struct stream_header_read_operation : operation<error_code>
 	{
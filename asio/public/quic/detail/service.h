@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <boost/asio/execution_context.hpp>
 #include <boost/intrusive/list.hpp>
@@ -12,21 +14,45 @@ namespace quic::detail
 	};
 	using service_list_base_hook = boost::intrusive::list_base_hook<boost::intrusive::tag<service_tag>>;
 
+	// registered objects remember their shard, so remove() finds it from any thread
+	struct service_entry : service_list_base_hook
+	{
+		unsigned service_shard = 0;
+	};
+
 
 	template<typename IoObject>
 	class service : public boost::asio::execution_context::service
 	{
+		// objects are registered with the shard of the thread that creates
+		// them, so threads churning through streams don't share one mutex
+		static constexpr unsigned num_shards = 16;
+
 		using base_hook = boost::intrusive::base_hook<service_list_base_hook>;
-		boost::intrusive::list<IoObject, base_hook> entries;
-		std::mutex mutex;
+		struct shard
+		{
+			boost::intrusive::list<IoObject, base_hook> entries;
+			std::mutex mutex;
+		};
+		std::array<shard, num_shards> shards;
+
+		static unsigned this_thread_shard()
+		{
+			static std::atomic<unsigned> next_shard{ 0 };
+			thread_local const unsigned index = next_shard.fetch_add(1, std::memory_order_relaxed) % num_shards;
+			return index;
+		}
 
 		void shutdown() override
 		{
-			while (!entries.empty())
+			for (auto& s : shards)
 			{
-				auto& entry = entries.front();
-				entries.pop_front();
-				entry.service_shutdown();
+				while (!s.entries.empty())
+				{
+					auto& entry = s.entries.front();
+					s.entries.pop_front();
+					entry.service_shutdown();
+				}
 			}
 		}
 	public:
@@ -40,20 +66,23 @@ namespace quic::detail
 
 		void add(IoObject& entry)
 		{
-			auto lock = std::scoped_lock{ mutex };
-			entries.push_back(entry);
+			entry.service_shard = this_thread_shard();
+			auto& s = shards[entry.service_shard];
+			auto lock = std::scoped_lock{ s.mutex };
+			s.entries.push_back(entry);
 		}
 
 		void remove(IoObject& entry)
 		{
-			auto lock = std::scoped_lock{ mutex };
-			if (entries.empty())
+			auto& s = shards[entry.service_shard];
+			auto lock = std::scoped_lock{ s.mutex };
+			if (!static_cast<service_list_base_hook&>(entry).is_linked())
 			{
 				// already shut down
 			}
 			else
 			{
-				entries.erase(entries.iterator_to(entry));
+				s.entries.erase(s.entries.iterator_to(entry));
 			}
 		}
 	};
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
 #include <lsquic.h>
 
+#include "../../h3/h3_priority.h"
 #include "engine_impl.h"
 #include "stream_impl.h"
 #include "socket_impl.h"
@@ -10,22 +15,62 @@ namespace quic::detail
 
 	stream_impl::stream_impl(connection_impl& conn)
 		: engine(conn._socket.engine),
-		  svc(boost::asio::use_service<service<stream_impl >>
-			  (
-				  boost::asio::query(engine.get_executor(), boost::asio::execution::context)
-			  )
-		  ),
+		  svc(conn._stream_svc),
 		  conn(conn),
-		  state(stream_state::closed{})
+		  state(stream_state::closed{}),
+		  read_deadline(*this, on_read_deadline),
+		  write_deadline(*this, on_write_deadline)
 	{
 		svc.add(*this);
 	}
 
 	stream_impl::~stream_impl()
 	{
+		if (read_deadline.maybe_scheduled() || write_deadline.maybe_scheduled())
+		{
+			auto lock = std::unique_lock{ engine.mutex };
+			engine.deadlines.cancel(read_deadline);
+			engine.deadlines.cancel(write_deadline);
+		}
 		svc.remove(*this);
 	}
 
+	void stream_impl::set_deadline(stream_deadline& d, const void* op,
+		deadline_clock::time_point deadline)
+	{
+		if (deadline == no_deadline)
+		{
+			engine.deadlines.cancel(d);
+			return;
+		}
+		d.op = op;
+		engine.deadlines.schedule(d, deadline);
+	}
+
+	void stream_impl::on_read_deadline(timer_wheel_entry& e)
+	{
+		auto& d = static_cast<stream_deadline&>(e);
+		auto& s = d.stream;
+		const auto t = stream_state::expire_read(s.state, d.op);
+		switch (t)
+		{
+		case stream_state::transition::accepting_to_closed:
+			s.conn.on_accepting_stream_closed(s);
+			break;
+		case stream_state::transition::connecting_to_closed:
+			s.conn.on_connecting_stream_closed(s);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void stream_impl::on_write_deadline(timer_wheel_entry& e)
+	{
+		auto& d = static_cast<stream_deadline&>(e);
+		stream_state::expire_write(d.stream.state, d.op);
+	}
+
 	void stream_impl::service_shutdown()
 	{
 		stream_state::destroy(state);
@@ -48,9 +93,34 @@ namespace quic::detail
 		return stream_state::id(state, ec);
 	}
 
+	void stream_impl::set_priority(unsigned priority, error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		stream_state::set_priority(state, priority, ec);
+	}
+
+	unsigned stream_impl::priority(error_code& ec) const
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		return stream_state::priority(state, ec);
+	}
+
+	void stream_impl::set_http_priority(const h3::priority& prio, error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		stream_state::set_http_priority(state, prio, ec);
+	}
+
+	h3::priority stream_impl::http_priority(error_code& ec) const
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		return stream_state::http_priority(state, ec);
+	}
+
 	void stream_impl::read_headers(stream_header_read_operation& op)
 	{
 		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(read_deadline, &op, no_deadline);
 		if (stream_state::read_headers(state, op))
 		{
 			engine.process(lock);
@@ -58,31 +128,196 @@ namespace quic::detail
 	}
 
 	void stream_impl::read_some(stream_data_operation& op)
+	{
+		read_some(op, no_deadline);
+	}
+
+	void stream_impl::read_some(stream_data_operation& op, deadline_clock::time_point deadline)
 	{
 		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(read_deadline, &op, deadline);
 		if (stream_state::read(state, op))
 		{
 			engine.process(lock);
 		}
+		else if (deadline != no_deadline)
+		{
+			engine.reschedule(lock);
+		}
+	}
+
+	void stream_impl::read_all(stream_data_operation& op)
+	{
+		if (op.truncated)
+		{
+			op.post(make_error_code(errc::invalid_argument), 0);
+			return;
+		}
+		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(read_deadline, &op, no_deadline);
+		if (stream_state::read_all(state, op))
+		{
+			engine.process(lock);
+		}
+	}
+
+	size_t stream_impl::try_read(stream_data_operation& op, error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		const size_t bytes = stream_state::try_read(state, op, ec);
+		if (bytes)
+		{
+			engine.process(lock); // may open the flow control window
+		}
+		return bytes;
 	}
 
 	void stream_impl::on_read()
 	{
-		stream_state::on_read(state);
+		if (stream_state::on_read(state))
+		{
+			conn.on_stream_readable(*this);
+		}
+	}
+
+	void stream_impl::set_read_ahead(size_t bytes, error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		if (stream_state::set_read_ahead(state, bytes, engine.budget, ec))
+		{
+			engine.process(lock);
+		}
 	}
 
 	void stream_impl::write_some(stream_data_operation& op)
+	{
+		write_some(op, no_deadline);
+	}
+
+	void stream_impl::write_some(stream_data_operation& op, deadline_clock::time_point deadline)
 	{
 		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(write_deadline, &op, deadline);
 		if (stream_state::write(state, op))
 		{
 			engine.process(lock);
 		}
+		else if (deadline != no_deadline)
+		{
+			engine.reschedule(lock);
+		}
+	}
+
+	size_t stream_impl::try_write(stream_data_operation& op, error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		const size_t bytes = stream_state::try_write(state, op, ec);
+		if (bytes)
+		{
+			engine.process(lock);
+		}
+		return bytes;
+	}
+
+	void stream_impl::wait(boost::asio::socket_base::wait_type w, stream_wait_operation& op)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		bool process = false;
+		switch (w)
+		{
+		case boost::asio::socket_base::wait_read:
+			set_deadline(read_deadline, &op, no_deadline);
+			process = stream_state::wait_read(state, op);
+			break;
+		case boost::asio::socket_base::wait_write:
+			set_deadline(write_deadline, &op, no_deadline);
+			process = stream_state::wait_write(state, op);
+			break;
+		default:
+			op.post(make_error_code(errc::operation_not_supported));
+			break;
+		}
+		if (process)
+		{
+			engine.process(lock);
+		}
+	}
+
+	void stream_impl::write_all(stream_data_operation& op)
+	{
+		if (op.truncated)
+		{
+			op.post(make_error_code(errc::invalid_argument), 0);
+			return;
+		}
+		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(write_deadline, &op, no_deadline);
+		if (stream_state::write_all(state, op))
+		{
+			engine.process(lock);
+		}
+	}
+
+	void stream_impl::write_fanout(fanout_write_operation& op)
+	{
+		const size_t count = op.streams.size();
+		if (count == 0)
+		{
+			op.post(error_code{}, std::vector<error_code>{});
+			return;
+		}
+		auto order = std::vector<size_t>(count);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&op](size_t a, size_t b)
+		{
+			return std::less<>{}(&op.streams[a]->engine, &op.streams[b]->engine);
+		});
+		// the last part to complete frees `op`, so the loop only touches it
+		// while some of its parts are still unstarted
+		size_t i = 0;
+		while (i < count)
+		{
+			auto& engine = op.streams[order[i]]->engine;
+			auto lock = std::unique_lock{ engine.mutex };
+			bool process = false;
+			for (; i < count && &op.streams[order[i]]->engine == &engine; i++)
+			{
+				auto& s = *op.streams[order[i]];
+				auto& part = op.parts[order[i]];
+				s.set_deadline(s.write_deadline, &part, no_deadline);
+				process |= stream_state::write_fanout(s.state, part);
+			}
+			if (process)
+			{
+				engine.process(lock);
+			}
+		}
+	}
+
+	void stream_impl::send_file(stream_file_operation& op, const error_code& map_ec)
+	{
+		if (map_ec)
+		{
+			op.post(map_ec, 0);
+			return;
+		}
+		// start paging in the first huge-page sized window. MADV_SEQUENTIAL
+		// readahead takes over as lsquic works through the rest
+		constexpr size_t readahead = 2 * 1024 * 1024;
+		op.mapping.will_need(0, readahead);
+
+		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(write_deadline, &op, no_deadline);
+		if (stream_state::write_all(state, op))
+		{
+			engine.process(lock);
+		}
 	}
 
 	void stream_impl::write_headers(stream_header_write_operation& op)
 	{
 		auto lock = std::unique_lock{ engine.mutex };
+		set_deadline(write_deadline, &op, no_deadline);
 		if (stream_state::write_headers(state, op))
 		{
 			engine.process(lock);
@@ -94,6 +329,21 @@ namespace quic::detail
 		stream_state::on_write(state);
 	}
 
+	void stream_impl::cork(error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		stream_state::cork(state, ec);
+	}
+
+	void stream_impl::uncork(error_code& ec)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		if (stream_state::uncork(state, ec))
+		{
+			engine.process(lock);
+		}
+	}
+
 	void stream_impl::flush(error_code& ec)
 	{
 		auto lock = std::unique_lock{ engine.mutex };
@@ -145,6 +395,8 @@ namespace quic::detail
 	void stream_impl::reset()
 	{
 		auto lock = std::unique_lock{ engine.mutex };
+		engine.deadlines.cancel(read_deadline); // so ~stream_impl() needn't lock
+		engine.deadlines.cancel(write_deadline);
 		const auto t = stream_state::reset(state);
 		switch (t)
 		{
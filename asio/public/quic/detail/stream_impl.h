@@ -1,11 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/socket_base.hpp>
 
 #include "operation.h"
 #include "service.h"
 #include "stream_state.h"
+#include "timer_wheel.h"
 #include "../quic_error.h"
 #include "../../h3/h3_fields.h"
 
@@ -17,28 +20,62 @@ namespace quic::detail
 	struct connection_impl;
 	struct engine_impl;
 
-	struct stream_impl : public boost::intrusive::list_base_hook<>, public service_list_base_hook
+	struct stream_impl : public boost::intrusive::list_base_hook<>, public service_entry
 	{
 		using executor_type = boost::asio::any_io_executor;
 		engine_impl& engine;
 		service<stream_impl>& svc;
 		connection_impl& conn;
 		stream_state::variant state;
+		// for synchronous read_some() and write_some(), which read it without
+		// the engine mutex
+		std::atomic<bool> nonblocking = false;
 
+		// the deadline of the operation pending in one direction. it stays
+		// scheduled after that operation completes, and does nothing when it
+		// fires unless `op` is still the one waiting
+		struct stream_deadline : timer_wheel_entry
+		{
+			stream_impl& stream;
+			const void* op = nullptr;
+
+			stream_deadline(stream_impl& stream, void (*expire)(timer_wheel_entry&)) noexcept
+				: timer_wheel_entry(expire), stream(stream)
+			{
+			}
+		};
+		stream_deadline read_deadline; // also covers accept and connect
+		stream_deadline write_deadline;
+
+		void set_deadline(stream_deadline& d, const void* op, deadline_clock::time_point deadline);
+		static void on_read_deadline(timer_wheel_entry& e);
+		static void on_write_deadline(timer_wheel_entry& e);
+
+		// takes up to max_iovs buffers. the *_some() operations transfer
+		// what fits, while write_all() and read_all() fail if any were left out
 		template<typename BufferSequence>
 		static void init_op(const BufferSequence& buffers, stream_data_operation& op)
 		{
 			const auto end = boost::asio::buffer_sequence_end(buffers);
-			for (auto i = boost::asio::buffer_sequence_begin(buffers);
-				 i != end && op.num_iovs < op.max_iovs;
-				 ++i, ++op.num_iovs)
+			auto i = boost::asio::buffer_sequence_begin(buffers);
+			for (; i != end && op.num_iovs < op.max_iovs; ++i, ++op.num_iovs)
 			{
 				op.iovs[op.num_iovs].iov_base = const_cast<void*>(i->data());
 				op.iovs[op.num_iovs].iov_len = i->size();
 			}
+			for (; i != end; ++i)
+			{
+				if (i->size())
+				{
+					op.truncated = true;
+					break;
+				}
+			}
 		}
 
 		explicit stream_impl(connection_impl& conn);
+		// only locks the engine mutex if a deadline is still scheduled.
+		// stream::~stream() resets first, which cancels them
 		~stream_impl();
 
 		void service_shutdown();
@@ -48,17 +85,23 @@ namespace quic::detail
 		bool is_open() const;
 		stream_id id(error_code& ec) const;
 
+		void set_priority(unsigned priority, error_code& ec);
+		unsigned priority(error_code& ec) const;
+
+		void set_http_priority(const h3::priority& prio, error_code& ec);
+		h3::priority http_priority(error_code& ec) const;
+
 		void read_headers(stream_header_read_operation& op);
 
-		template<typename CompletionToken>
-		decltype(auto) async_read_headers(h3::fields& fields, CompletionToken&& token)
+		template<typename IoExecutor, typename CompletionToken>
+		decltype(auto) async_read_headers(const IoExecutor& io_ex, h3::fields& fields, CompletionToken&& token)
 		{
 			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
-				[this, &fields](auto h)
+				[this, &fields, io_ex](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
-					using op_type = stream_header_read_async<Handler, executor_type>;
-					auto p = handler_allocate<op_type>(h, std::move(h), get_executor(), fields);
+					using op_type = stream_header_read_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex, fields);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
 					read_headers(*op);
 					op.release(); // release ownership
@@ -66,48 +109,94 @@ namespace quic::detail
 		}
 
 		void read_some(stream_data_operation& op);
+		void read_some(stream_data_operation& op, deadline_clock::time_point deadline);
+		size_t try_read(stream_data_operation& op, error_code& ec);
 		void on_read();
 
-		template<typename MutableBufferSequence, typename CompletionToken>
-		decltype(auto) async_read_some(const MutableBufferSequence& buffers, CompletionToken&& token)
+		void set_read_ahead(size_t bytes, error_code& ec);
+
+		template<typename IoExecutor, typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read_some(const IoExecutor& io_ex, const MutableBufferSequence& buffers,
+			deadline_clock::time_point deadline, CompletionToken&& token)
 		{
 			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
-				[this, &buffers](auto h)
+				[this, &buffers, deadline, io_ex](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
-					using op_type = stream_data_async<Handler, executor_type>;
-					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					using op_type = stream_data_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
 					init_op(buffers, *op);
-					read_some(*op);
+					read_some(*op, deadline);
 					op.release();
 				}, token);
 		}
 
+		template<typename IoExecutor, typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read_some(const IoExecutor& io_ex, const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return async_read_some(io_ex, buffers, no_deadline, std::forward<CompletionToken>(token));
+		}
+
 		template<typename MutableBufferSequence>
 		std::enable_if_t<boost::asio::is_mutable_buffer_sequence<MutableBufferSequence>::value, size_t>
 		read_some(const MutableBufferSequence& buffers, error_code& ec)
 		{
 			stream_data_sync op;
 			init_op(buffers, op);
+			if (nonblocking)
+			{
+				return try_read(op, ec);
+			}
 			read_some(op);
 			op.wait();
 			ec = std::get<0>(*op.result);
 			return std::get<1>(*op.result);
 		}
 
+		void read_all(stream_data_operation& op);
+
+		template<typename IoExecutor, typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read(const IoExecutor& io_ex, const MutableBufferSequence& buffers, size_t minimum, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, &buffers, minimum, io_ex](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = stream_data_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					init_op(buffers, *op);
+					op->minimum = minimum;
+					read_all(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		template<typename MutableBufferSequence>
+		size_t read(const MutableBufferSequence& buffers, size_t minimum, error_code& ec)
+		{
+			stream_data_sync op;
+			init_op(buffers, op);
+			op.minimum = minimum;
+			read_all(op);
+			op.wait();
+			ec = std::get<0>(*op.result);
+			return std::get<1>(*op.result);
+		}
+
 		void write_headers(stream_header_write_operation& op);
 
-		template<typename CompletionToken>
-		decltype(auto) async_write_headers(const h3::fields& fields, CompletionToken&& token)
+		template<typename IoExecutor, typename CompletionToken>
+		decltype(auto) async_write_headers(const IoExecutor& io_ex, const h3::fields& fields, CompletionToken&& token)
 		{
 			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
-				[this, &fields](auto h)
+				[this, &fields, io_ex](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
-					using op_type = stream_header_write_async<Handler, executor_type>;
+					using op_type = stream_header_write_async<Handler, IoExecutor>;
 					auto p = handler_allocate<op_type>(h, std::move(h),
-						get_executor(), fields);
+						io_ex, fields);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
 					write_headers(*op);
 					op.release(); // release ownership
@@ -115,51 +204,174 @@ namespace quic::detail
 		}
 
 		void write_some(stream_data_operation& op);
+		void write_some(stream_data_operation& op, deadline_clock::time_point deadline);
+		size_t try_write(stream_data_operation& op, error_code& ec);
 		void on_write();
 
-		template<typename ConstBufferSequence, typename CompletionToken>
-		decltype(auto) async_write_some(const ConstBufferSequence& buffers, CompletionToken&& token)
+		template<typename IoExecutor, typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_some(const IoExecutor& io_ex, const ConstBufferSequence& buffers,
+			deadline_clock::time_point deadline, CompletionToken&& token)
 		{
 			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
-				[this, &buffers](auto h)
+				[this, &buffers, deadline, io_ex](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
-					using op_type = stream_data_async<Handler, executor_type>;
-					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					using op_type = stream_data_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
 					init_op(buffers, *op);
-					write_some(*op);
+					write_some(*op, deadline);
 					op.release(); // release ownership
 				}, token);
 		}
 
+		template<typename IoExecutor, typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_some(const IoExecutor& io_ex, const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return async_write_some(io_ex, buffers, no_deadline, std::forward<CompletionToken>(token));
+		}
+
 		template<typename ConstBufferSequence>
 		std::enable_if_t<boost::asio::is_const_buffer_sequence<ConstBufferSequence>::value, size_t>
 		write_some(const ConstBufferSequence& buffers, error_code& ec)
 		{
 			stream_data_sync op;
 			init_op(buffers, op);
+			if (nonblocking)
+			{
+				return try_write(op, ec);
+			}
 			write_some(op);
 			op.wait();
 			ec = std::get<0>(*op.result);
 			return std::get<1>(*op.result);
 		}
 
+		void wait(boost::asio::socket_base::wait_type w, stream_wait_operation& op);
+
+		template<typename IoExecutor, typename CompletionToken>
+		decltype(auto) async_wait(const IoExecutor& io_ex, boost::asio::socket_base::wait_type w, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
+				[this, w, io_ex](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = stream_wait_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					wait(w, *op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		void write_all(stream_data_operation& op);
+
+		template<typename IoExecutor, typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_all(const IoExecutor& io_ex, const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, &buffers, io_ex](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = stream_data_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					init_op(buffers, *op);
+					write_all(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		template<typename ConstBufferSequence>
+		std::enable_if_t<boost::asio::is_const_buffer_sequence<ConstBufferSequence>::value, size_t>
+		write_all(const ConstBufferSequence& buffers, error_code& ec)
+		{
+			stream_data_sync op;
+			init_op(buffers, op);
+			write_all(op);
+			op.wait();
+			ec = std::get<0>(*op.result);
+			return std::get<1>(*op.result);
+		}
+
+		// start every part of a fan-out write, locking and processing each
+		// engine once for all of its streams
+		static void write_fanout(fanout_write_operation& op);
+
+		template<typename CompletionToken>
+		static decltype(auto) async_write_fanout(const executor_type& io_ex,
+			std::vector<stream_impl*> streams, std::shared_ptr<const std::vector<char>> payload,
+			CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, std::vector<error_code>)>(
+				[io_ex, streams = std::move(streams), payload = std::move(payload)](auto h) mutable
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = fanout_write_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex,
+						std::move(streams), std::move(payload));
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					write_fanout(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		static std::vector<error_code> write_fanout(std::vector<stream_impl*> streams,
+			std::shared_ptr<const std::vector<char>> payload)
+		{
+			fanout_write_sync op{ std::move(streams), std::move(payload) };
+			write_fanout(op);
+			op.wait();
+			return std::get<1>(std::move(*op.result));
+		}
+
+		void send_file(stream_file_operation& op, const error_code& map_ec);
+
+		template<typename IoExecutor, typename CompletionToken>
+		decltype(auto) async_send_file(const IoExecutor& io_ex, int fd, off_t offset, size_t length, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, size_t)>(
+				[this, fd, offset, length, io_ex](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = stream_file_async<Handler, IoExecutor>;
+					error_code ec;
+					auto mapping = file_mapping{ fd, offset, length, ec };
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex, std::move(mapping));
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					send_file(*op, ec);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		size_t send_file(int fd, off_t offset, size_t length, error_code& ec)
+		{
+			auto mapping = file_mapping{ fd, offset, length, ec };
+			stream_file_sync op{ std::move(mapping) };
+			send_file(op, ec);
+			op.wait();
+			ec = std::get<0>(*op.result);
+			return std::get<1>(*op.result);
+		}
+
+		void cork(error_code& ec);
+		void uncork(error_code& ec);
+
 		void flush(error_code& ec);
 		void shutdown(int how, error_code& ec);
 
 		void close(stream_close_operation& op);
 		void on_close();
 
-		template<typename CompletionToken>
-		decltype(auto) async_close(CompletionToken&& token)
+		template<typename IoExecutor, typename CompletionToken>
+		decltype(auto) async_close(const IoExecutor& io_ex, CompletionToken&& token)
 		{
 			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
-				[this](auto h)
+				[this, io_ex](auto h)
 				{
 					using Handler = std::decay_t<decltype(h)>;
-					using op_type = stream_close_async<Handler, executor_type>;
-					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					using op_type = stream_close_async<Handler, IoExecutor>;
+					auto p = handler_allocate<op_type>(h, std::move(h), io_ex);
 					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
 					close(*op);
 					op.release(); // release ownership
@@ -1,6 +1,8 @@
+#include <utility>
 #include <lsquic.h>
 
 #include "recv_header_set.h"
+#include "../../h3/h3_priority.h"
 
 #include "stream_state.h"
 #include "connection_impl.h"
@@ -10,6 +12,57 @@
 namespace quic::detail
 {
 
+	static size_t buffer_size(const stream_data_operation& op)
+	{
+		size_t bytes = 0;
+		for (uint16_t i = 0; i < op.num_iovs; i++)
+		{
+			bytes += op.iovs[i].iov_len;
+		}
+		return bytes;
+	}
+
+	// how many bytes read_all() waits for
+	static size_t read_target(const stream_data_operation& op)
+	{
+		const size_t total = buffer_size(op);
+		return op.minimum ? std::min(op.minimum, total) : total;
+	}
+
+	// sending and receiving streams name their states alike, so both expire
+	// the same way. a pending header goes back to expecting_header, a
+	// pending body or wait to expecting_body
+	template<typename ExpectingHeader, typename ExpectingBody, typename Header,
+		typename Body, typename BodyAll, typename Waiting, typename Variant>
+	static bool expire_pending(Variant& state, const void* op, error_code ec)
+	{
+		if (auto h = std::get_if<Header>(&state); h && h->op == op)
+		{
+			h->op->defer(ec);
+			state = ExpectingHeader{};
+			return true;
+		}
+		if (auto b = std::get_if<Body>(&state); b && b->op == op)
+		{
+			b->op->defer(ec, 0);
+			state = ExpectingBody{};
+			return true;
+		}
+		if (auto b = std::get_if<BodyAll>(&state); b && b->op == op)
+		{
+			b->op->defer(ec, b->op->bytes_transferred);
+			state = ExpectingBody{};
+			return true;
+		}
+		if (auto w = std::get_if<Waiting>(&state); w && w->op == op)
+		{
+			w->op->defer(ec);
+			state = ExpectingBody{};
+			return true;
+		}
+		return false;
+	}
+
 	namespace sending_stream_state
 	{
 
@@ -53,6 +106,56 @@ namespace quic::detail
 			state = body{ &op };
 		}
 
+		void write_body_all(variant& state, lsquic_stream* handle, data_operation& op)
+		{
+			if (std::holds_alternative<shutdown>(state))
+			{
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
+				return;
+			}
+			if (!std::holds_alternative<expecting_body>(state))
+			{
+				op.post(make_error_code(errc::invalid_argument), 0);
+				return;
+			}
+			if (buffer_size(op) == 0)
+			{
+				op.post(error_code{}, 0);
+				return;
+			}
+			if (::lsquic_stream_wantwrite(handle, 1) == -1)
+			{
+				op.post(error_code{ errno, system_category() }, 0);
+				return;
+			}
+			state = body_all{ &op };
+		}
+
+		void write_fanout(variant& state, lsquic_stream* handle, fanout_part& op)
+		{
+			if (std::holds_alternative<shutdown>(state))
+			{
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
+				return;
+			}
+			if (!std::holds_alternative<expecting_body>(state))
+			{
+				op.post(make_error_code(errc::invalid_argument), 0);
+				return;
+			}
+			if (op.parent->payload->empty())
+			{
+				op.post(error_code{}, 0);
+				return;
+			}
+			if (::lsquic_stream_wantwrite(handle, 1) == -1)
+			{
+				op.post(error_code{ errno, system_category() }, 0);
+				return;
+			}
+			state = fanout{ &op };
+		}
+
 		void on_write_header(variant& state, lsquic_stream* handle)
 		{
 			auto& h = *std::get_if<header>(&state);
@@ -101,20 +204,145 @@ namespace quic::detail
 			state = expecting_body{};
 		}
 
-		void on_write(variant& state, lsquic_stream* handle)
+		// lsquic_reader over the operation's iovecs. lsquic copies straight from
+		// them into its outgoing packets, and bytes_transferred remembers how far
+		// it got between callbacks
+		static size_t reader_size(void* ctx)
+		{
+			auto& op = *static_cast<data_operation*>(ctx);
+			return buffer_size(op) - op.bytes_transferred;
+		}
+
+		static size_t reader_read(void* ctx, void* buf, size_t count)
+		{
+			auto& op = *static_cast<data_operation*>(ctx);
+			auto out = static_cast<char*>(buf);
+			size_t skip = op.bytes_transferred;
+			size_t copied = 0;
+			for (uint16_t i = 0; i < op.num_iovs && copied < count; i++)
+			{
+				const auto& iov = op.iovs[i];
+				if (skip >= iov.iov_len)
+				{
+					skip -= iov.iov_len;
+					continue;
+				}
+				const size_t n = std::min(iov.iov_len - skip, count - copied);
+				::memcpy(out + copied, static_cast<const char*>(iov.iov_base) + skip, n);
+				copied += n;
+				skip = 0;
+			}
+			op.bytes_transferred += copied;
+			return copied;
+		}
+
+		bool on_write_body_all(variant& state, lsquic_stream* handle)
+		{
+			auto& b = *std::get_if<body_all>(&state);
+			auto reader = lsquic_reader{ reader_read, reader_size, b.op };
+			if (::lsquic_stream_writef(handle, &reader) == -1)
+			{
+				b.op->defer(error_code{ errno, system_category() }, b.op->bytes_transferred);
+				state = expecting_body{};
+				return false;
+			}
+			if (reader_size(b.op) > 0)
+			{
+				return true; // wait for the next on_write()
+			}
+			b.op->defer(error_code{}, b.op->bytes_transferred);
+			state = expecting_body{};
+			return false;
+		}
+
+		// every part reads from the same payload, each at its own offset
+		static size_t fanout_size(void* ctx)
+		{
+			auto& op = *static_cast<fanout_part*>(ctx);
+			return op.parent->payload->size() - op.bytes_transferred;
+		}
+
+		static size_t fanout_read(void* ctx, void* buf, size_t count)
+		{
+			auto& op = *static_cast<fanout_part*>(ctx);
+			const auto& payload = *op.parent->payload;
+			const size_t n = std::min(payload.size() - op.bytes_transferred, count);
+			::memcpy(buf, payload.data() + op.bytes_transferred, n);
+			op.bytes_transferred += n;
+			return n;
+		}
+
+		static bool on_write_fanout(variant& state, lsquic_stream* handle)
+		{
+			auto& f = *std::get_if<fanout>(&state);
+			auto reader = lsquic_reader{ fanout_read, fanout_size, f.op };
+			if (::lsquic_stream_writef(handle, &reader) == -1)
+			{
+				f.op->defer(error_code{ errno, system_category() }, f.op->bytes_transferred);
+				state = expecting_body{};
+				return false;
+			}
+			if (fanout_size(f.op) > 0)
+			{
+				return true; // wait for the next on_write()
+			}
+			f.op->defer(error_code{}, f.op->bytes_transferred);
+			state = expecting_body{};
+			return false;
+		}
+
+		void wait(variant& state, lsquic_stream* handle, stream_wait_operation& op)
 		{
 			if (std::holds_alternative<shutdown>(state))
 			{
+				op.post(make_error_code(errc::bad_file_descriptor));
 				return;
 			}
+			if (!std::holds_alternative<expecting_body>(state))
+			{
+				op.post(make_error_code(errc::invalid_argument));
+				return;
+			}
+			if (::lsquic_stream_wantwrite(handle, 1) == -1)
+			{
+				op.post(error_code{ errno, system_category() });
+				return;
+			}
+			state = waiting{ &op };
+		}
+
+		bool on_write(variant& state, lsquic_stream* handle)
+		{
+			if (std::holds_alternative<waiting>(state))
+			{
+				std::get_if<waiting>(&state)->op->defer(error_code{});
+				state = expecting_body{};
+				return false;
+			}
+			else if (std::holds_alternative<fanout>(state))
+			{
+				return on_write_fanout(state, handle);
+			}
+			else if (!std::holds_alternative<header>(state) &&
+				!std::holds_alternative<body>(state) &&
+				!std::holds_alternative<body_all>(state))
+			{
+				return false; // shut down, or only draining corked writes
+			}
 			else if (std::holds_alternative<header>(state))
 			{
 				on_write_header(state, handle);
+				return false;
+			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				return on_write_body_all(state, handle);
 			}
 			else
 			{
 				assert(std::holds_alternative<body>(state));
 				on_write_body(state, handle);
+				return false;
 			}
 		}
 
@@ -138,12 +366,47 @@ namespace quic::detail
 				state = shutdown{};
 				return 1;
 			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				if (auto op = std::get_if<body_all>(&state)->op; op)
+				{
+					op->defer(ec, op->bytes_transferred);
+				}
+				state = shutdown{};
+				return 1;
+			}
+			else if (std::holds_alternative<fanout>(state))
+			{
+				if (auto op = std::get_if<fanout>(&state)->op; op)
+				{
+					op->defer(ec, op->bytes_transferred);
+				}
+				state = shutdown{};
+				return 1;
+			}
+			else if (std::holds_alternative<waiting>(state))
+			{
+				if (auto op = std::get_if<waiting>(&state)->op; op)
+				{
+					op->defer(ec);
+				}
+				state = shutdown{};
+				return 1;
+			}
 			else
 			{
 				return 0;
 			}
 		}
 
+		// a fanout part never expires here, write_fanout() cancels the write
+		// deadline before starting it
+		bool expire(variant& state, const void* op, error_code ec)
+		{
+			return expire_pending<expecting_header, expecting_body,
+				header, body, body_all, waiting>(state, op, ec);
+		}
+
 		void destroy(variant& state)
 		{
 			if (std::holds_alternative<header>(state))
@@ -158,6 +421,24 @@ namespace quic::detail
 				b.op->destroy(error_code{}, 0);
 				b.op = nullptr;
 			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				auto& b = *std::get_if<body_all>(&state);
+				b.op->destroy(error_code{}, 0);
+				b.op = nullptr;
+			}
+			else if (std::holds_alternative<fanout>(state))
+			{
+				auto& f = *std::get_if<fanout>(&state);
+				f.op->destroy(error_code{}, 0);
+				f.op = nullptr;
+			}
+			else if (std::holds_alternative<waiting>(state))
+			{
+				auto& w = *std::get_if<waiting>(&state);
+				w.op->destroy(error_code{});
+				w.op = nullptr;
+			}
 		}
 
 	} // namespace sending_stream_state
@@ -195,6 +476,26 @@ namespace quic::detail
 			state = body{ &op };
 		}
 
+		void read_body_all(variant& state, lsquic_stream* handle, data_operation& op)
+		{
+			if (!std::holds_alternative<expecting_body>(state))
+			{
+				op.post(make_error_code(errc::invalid_argument), op.bytes_transferred);
+				return;
+			}
+			if (op.bytes_transferred >= read_target(op))
+			{
+				op.post(error_code{}, op.bytes_transferred);
+				return;
+			}
+			if (::lsquic_stream_wantread(handle, 1) == -1)
+			{
+				op.post(error_code{ errno, system_category() }, op.bytes_transferred);
+				return;
+			}
+			state = body_all{ &op };
+		}
+
 		void on_read_header(variant& state, lsquic_stream* handle)
 		{
 			auto& h = *std::get_if<header>(&state);
@@ -227,21 +528,169 @@ namespace quic::detail
 			state = expecting_body{};
 		}
 
-		void on_read(variant& state, lsquic_stream* handle)
+		// the part of the operation's iovecs that hasn't been filled yet
+		static uint16_t remaining_iovs(const data_operation& op, iovec* iovs)
 		{
-			if (std::holds_alternative<shutdown>(state))
+			size_t skip = op.bytes_transferred;
+			uint16_t count = 0;
+			for (uint16_t i = 0; i < op.num_iovs; i++)
+			{
+				const auto& iov = op.iovs[i];
+				if (skip >= iov.iov_len)
+				{
+					skip -= iov.iov_len;
+					continue;
+				}
+				iovs[count].iov_base = static_cast<char*>(iov.iov_base) + skip;
+				iovs[count].iov_len = iov.iov_len - skip;
+				skip = 0;
+				count++;
+			}
+			return count;
+		}
+
+		// read everything lsquic has, and complete once the target is reached
+		static void on_read_body_all(variant& state, lsquic_stream* handle)
+		{
+			auto& op = *std::get_if<body_all>(&state)->op;
+			const size_t target = read_target(op);
+			error_code ec;
+			while (op.bytes_transferred < target)
+			{
+				iovec iovs[data_operation::max_iovs];
+				const auto count = remaining_iovs(op, iovs);
+				const auto bytes = ::lsquic_stream_readv(handle, iovs, count);
+				if (bytes == -1)
+				{
+					if (errno == EWOULDBLOCK || errno == EAGAIN)
+					{
+						return; // wait for the next on_read()
+					}
+					ec.assign(errno, system_category());
+					break;
+				}
+				if (bytes == 0)
+				{
+					ec = make_error_code(stream_error::eof);
+					break;
+				}
+				op.bytes_transferred += bytes;
+			}
+			op.defer(ec, op.bytes_transferred);
+			state = expecting_body{};
+		}
+
+		void wait(variant& state, lsquic_stream* handle, stream_wait_operation& op)
+		{
+			if (!std::holds_alternative<expecting_body>(state))
+			{
+				op.post(make_error_code(errc::invalid_argument));
+				return;
+			}
+			if (::lsquic_stream_wantread(handle, 1) == -1)
 			{
+				op.post(error_code{ errno, system_category() });
 				return;
 			}
+			state = waiting{ &op };
+		}
+
+		void on_read(variant& state, lsquic_stream* handle)
+		{
+			if (std::holds_alternative<waiting>(state))
+			{
+				std::get_if<waiting>(&state)->op->defer(error_code{});
+				state = expecting_body{};
+			}
 			else if (std::holds_alternative<header>(state))
 			{
 				on_read_header(state, handle);
 			}
-			else
+			else if (std::holds_alternative<body>(state))
 			{
-				assert(std::holds_alternative<body>(state));
 				on_read_body(state, handle);
 			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				on_read_body_all(state, handle);
+			}
+			// otherwise shut down, or only draining into read-ahead
+		}
+
+		// copy buffered read-ahead bytes into the operation's iovecs
+		static size_t drain_read_ahead(read_ahead& ahead, data_operation& op)
+		{
+			size_t copied = 0;
+			for (uint16_t i = 0; i < op.num_iovs && ahead.buffered(); i++)
+			{
+				const auto& iov = op.iovs[i];
+				const size_t n = std::min(iov.iov_len, ahead.buffered());
+				::memcpy(iov.iov_base, ahead.buffer.data() + ahead.begin, n);
+				ahead.begin += n;
+				copied += n;
+			}
+			if (ahead.begin == ahead.end)
+			{
+				ahead.begin = ahead.end = 0;
+			}
+			return copied;
+		}
+
+		// pull whatever lsquic has ready into the read-ahead buffer. returns true
+		// if there's room left and the stream may still produce more
+		static bool fill_read_ahead(read_ahead& ahead, lsquic_stream* handle)
+		{
+			while (!ahead.full())
+			{
+				// not full, so there's room in front of begin. make it contiguous
+				// rather than asking lsquic for 0 bytes, which looks like eof
+				if (ahead.end == ahead.buffer.size())
+				{
+					::memmove(ahead.buffer.data(), ahead.buffer.data() + ahead.begin, ahead.buffered());
+					ahead.end -= ahead.begin;
+					ahead.begin = 0;
+				}
+				const auto bytes = ::lsquic_stream_read(handle, ahead.buffer.data() + ahead.end,
+					ahead.buffer.size() - ahead.end);
+				if (bytes == -1)
+				{
+					if (errno != EWOULDBLOCK && errno != EAGAIN)
+					{
+						ahead.ec.assign(errno, system_category());
+						return false;
+					}
+					break;
+				}
+				if (bytes == 0)
+				{
+					ahead.eof = true;
+					return false;
+				}
+				ahead.end += bytes;
+			}
+			return !ahead.full();
+		}
+
+		// complete a read from the read-ahead buffer. returns true if draining
+		// had paused at the high watermark and was resumed
+		static bool read_buffered(read_ahead& ahead, lsquic_stream* handle, data_operation& op)
+		{
+			const size_t bytes = drain_read_ahead(ahead, op);
+			if (bytes)
+			{
+				op.post(error_code{}, bytes);
+			}
+			else
+			{
+				op.post(ahead.ec, 0); // eof or error
+			}
+			if (ahead.paused && ahead.below_low_watermark())
+			{
+				ahead.paused = false;
+				::lsquic_stream_wantread(handle, 1);
+				return true;
+			}
+			return false;
 		}
 
 		int cancel(variant& state, error_code ec)
@@ -264,12 +713,36 @@ namespace quic::detail
 				state = shutdown{};
 				return 1;
 			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				if (auto op = std::get_if<body_all>(&state)->op; op)
+				{
+					op->defer(ec, op->bytes_transferred);
+				}
+				state = shutdown{};
+				return 1;
+			}
+			else if (std::holds_alternative<waiting>(state))
+			{
+				if (auto op = std::get_if<waiting>(&state)->op; op)
+				{
+					op->defer(ec);
+				}
+				state = shutdown{};
+				return 1;
+			}
 			else
 			{
 				return 0;
 			}
 		}
 
+		bool expire(variant& state, const void* op, error_code ec)
+		{
+			return expire_pending<expecting_header, expecting_body,
+				header, body, body_all, waiting>(state, op, ec);
+		}
+
 		void destroy(variant& state)
 		{
 			if (std::holds_alternative<header>(state))
@@ -284,6 +757,18 @@ namespace quic::detail
 				b.op->destroy(error_code{}, 0);
 				b.op = nullptr;
 			}
+			else if (std::holds_alternative<body_all>(state))
+			{
+				auto& b = *std::get_if<body_all>(&state);
+				b.op->destroy(error_code{}, 0);
+				b.op = nullptr;
+			}
+			else if (std::holds_alternative<waiting>(state))
+			{
+				auto& w = *std::get_if<waiting>(&state);
+				w.op->destroy(error_code{});
+				w.op = nullptr;
+			}
 		}
 
 	} // namespace receiving_stream_state
@@ -296,69 +781,441 @@ namespace quic::detail
 			return std::holds_alternative<open>(state);
 		}
 
-		stream_id id(const variant& state, error_code& ec)
-		{
-			stream_id sid = 0;
-			if (std::holds_alternative<open>(state))
+		stream_id id(const variant& state, error_code& ec)
+		{
+			stream_id sid = 0;
+			if (std::holds_alternative<open>(state))
+			{
+				auto& o = *std::get_if<open>(&state);
+				sid = ::lsquic_stream_id(&o.handle);
+				ec = error_code{};
+			}
+			else
+			{
+				ec = make_error_code(errc::not_connected);
+			}
+			return sid;
+		}
+
+		void set_priority(variant& state, unsigned priority, error_code& ec)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return;
+			}
+			auto& o = *std::get_if<open>(&state);
+			if (priority < 1 || priority > 256 ||
+				::lsquic_stream_set_priority(&o.handle, priority) == -1)
+			{
+				ec = make_error_code(errc::invalid_argument);
+				return;
+			}
+			ec = error_code{};
+		}
+
+		unsigned priority(const variant& state, error_code& ec)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return 0;
+			}
+			auto& o = *std::get_if<open>(&state);
+			ec = error_code{};
+			return ::lsquic_stream_priority(&o.handle);
+		}
+
+		void set_http_priority(variant& state, const h3::priority& prio, error_code& ec)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return;
+			}
+			if (prio.urgency > LSQUIC_MAX_HTTP_URGENCY)
+			{
+				ec = make_error_code(errc::invalid_argument);
+				return;
+			}
+			auto& o = *std::get_if<open>(&state);
+			lsquic_ext_http_prio ehp;
+			ehp.urgency = prio.urgency;
+			ehp.incremental = prio.incremental;
+			// fails on streams that aren't using extensible priorities
+			if (::lsquic_stream_set_http_prio(&o.handle, &ehp) == -1)
+			{
+				ec = make_error_code(errc::operation_not_supported);
+				return;
+			}
+			ec = error_code{};
+		}
+
+		h3::priority http_priority(const variant& state, error_code& ec)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return {};
+			}
+			auto& o = *std::get_if<open>(&state);
+			lsquic_ext_http_prio ehp;
+			if (::lsquic_stream_get_http_prio(const_cast<lsquic_stream*>(&o.handle), &ehp) == -1)
+			{
+				ec = make_error_code(errc::operation_not_supported);
+				return {};
+			}
+			ec = error_code{};
+			return h3::priority{ ehp.urgency, ehp.incremental != 0 };
+		}
+
+		void reopen(variant& state, error_code& ec)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				state = closed{}; // nobody is left to report it to
+			}
+			if (std::holds_alternative<closed>(state))
+			{
+				ec = error_code{};
+			}
+			else
+			{
+				ec = make_error_code(errc::invalid_argument);
+			}
+		}
+
+		void connect(variant& state, stream_connect_operation& op)
+		{
+			assert(std::holds_alternative<closed>(state));
+			state = connecting{ &op };
+		}
+
+		void on_connect(variant& state, lsquic_stream* handle, bool is_http)
+		{
+			assert(std::holds_alternative<connecting>(state));
+			std::get_if<connecting>(&state)->op->defer(error_code{});
+			if (is_http)
+			{
+				state.emplace<open>(*handle, open::h3_tag{});
+			}
+			else
+			{
+				state.emplace<open>(*handle, open::quic_tag{});
+			}
+		}
+
+		void accept(variant& state, stream_accept_operation& op)
+		{
+			assert(std::holds_alternative<closed>(state));
+			state = accepting{ &op };
+		}
+
+		void accept(variant& state)
+		{
+			assert(std::holds_alternative<closed>(state));
+			state = accepting{};
+		}
+
+		void on_accept(variant& state, lsquic_stream* handle, bool is_http)
+		{
+			if (std::holds_alternative<accepting>(state))
+			{
+				if (auto op = std::get_if<accepting>(&state)->op; op)
+				{
+					op->defer(error_code{});
+				}
+			}
+			else
+			{
+				assert(std::holds_alternative<closed>(state));
+			}
+			if (is_http)
+			{
+				state.emplace<open>(*handle, open::h3_tag{});
+			}
+			else
+			{
+				state.emplace<open>(*handle, open::quic_tag{});
+			}
+		}
+
+		bool read(variant& state, stream_data_operation& op)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				op.post(std::get_if<error>(&state)->ec, 0);
+				state = closed{};
+				return false;
+			}
+			else if (std::holds_alternative<open>(state))
+			{
+				auto& o = *std::get_if<open>(&state);
+				o.reported = false;
+				if (o.ahead.enabled() &&
+					std::holds_alternative<receiving_stream_state::expecting_body>(o.in) &&
+					(o.ahead.buffered() || o.ahead.eof || o.ahead.ec))
+				{
+					return receiving_stream_state::read_buffered(o.ahead, &o.handle, op);
+				}
+				receiving_stream_state::read_body(o.in, &o.handle, op);
+				return true;
+			}
+			else
+			{
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
+				return false;
+			}
+		}
+
+		bool read_all(variant& state, stream_data_operation& op)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				op.post(std::get_if<error>(&state)->ec, 0);
+				state = closed{};
+				return false;
+			}
+			if (!std::holds_alternative<open>(state))
+			{
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
+				return false;
+			}
+			auto& o = *std::get_if<open>(&state);
+			o.reported = false;
+			auto& ahead = o.ahead;
+			if (ahead.enabled() &&
+				std::holds_alternative<receiving_stream_state::expecting_body>(o.in) &&
+				(ahead.buffered() || ahead.eof || ahead.ec))
+			{
+				op.bytes_transferred = receiving_stream_state::drain_read_ahead(ahead, op);
+				if (op.bytes_transferred < read_target(op) && (ahead.eof || ahead.ec))
+				{
+					op.post(ahead.ec ? ahead.ec : make_error_code(stream_error::eof), op.bytes_transferred);
+					return false;
+				}
+				ahead.paused = false; // the rest comes straight from lsquic
+			}
+			receiving_stream_state::read_body_all(o.in, &o.handle, op);
+			return true;
+		}
+
+		bool read_headers(variant& state, stream_header_read_operation& op)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				op.post(std::get_if<error>(&state)->ec);
+				state = closed{};
+				return false;
+			}
+			else if (std::holds_alternative<open>(state))
+			{
+				auto& o = *std::get_if<open>(&state);
+				receiving_stream_state::read_header(o.in, &o.handle, op);
+				return true;
+			}
+			else
+			{
+				op.post(make_error_code(errc::bad_file_descriptor));
+				return false;
+			}
+		}
+
+		bool on_read(variant& state)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				return false; // closing, but still writing gathered bytes
+			}
+			auto& o = *std::get_if<open>(&state);
+			const bool idle = std::holds_alternative<receiving_stream_state::expecting_body>(o.in);
+			receiving_stream_state::on_read(o.in, &o.handle);
+
+			auto& ahead = o.ahead;
+			bool want = false;
+			if (ahead.enabled() && !ahead.eof && !ahead.ec &&
+				std::holds_alternative<receiving_stream_state::expecting_body>(o.in))
+			{
+				want = receiving_stream_state::fill_read_ahead(ahead, &o.handle);
+				ahead.paused = ahead.full();
+			}
+
+			bool readable = false;
+			if (o.watched && std::holds_alternative<receiving_stream_state::expecting_body>(o.in))
+			{
+				if (!idle)
+				{
+					want = true; // a read just finished, keep watching for more
+				}
+				else if (!o.reported)
+				{
+					o.reported = true;
+					readable = true;
+				}
+			}
+			if (std::holds_alternative<receiving_stream_state::body_all>(o.in))
+			{
+				want = true; // read_all() is still filling its buffers
+			}
+			if (!want)
+			{
+				::lsquic_stream_wantread(&o.handle, 0);
+			}
+			return readable;
+		}
+
+		void watch_readable(variant& state)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				return;
+			}
+			auto& o = *std::get_if<open>(&state);
+			o.watched = true;
+			if (!o.reported && std::holds_alternative<receiving_stream_state::expecting_body>(o.in))
+			{
+				::lsquic_stream_wantread(&o.handle, 1);
+			}
+		}
+
+		bool set_read_ahead(variant& state, size_t bytes, memory_budget& budget, error_code& ec)
+		{
+			if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return false;
+			}
+			auto& o = *std::get_if<open>(&state);
+			auto& ahead = o.ahead;
+			if (bytes < ahead.buffered())
+			{
+				ec = make_error_code(errc::invalid_argument);
+				return false;
+			}
+			auto charge = memory_charge{ budget };
+			if (!charge.try_grow(bytes))
+			{
+				ec = make_error_code(errc::no_buffer_space);
+				return false;
+			}
+			// move anything already buffered to the front of the new buffer
+			auto buffer = std::vector<char>(bytes);
+			if (ahead.buffered())
+			{
+				::memcpy(buffer.data(), ahead.buffer.data() + ahead.begin, ahead.buffered());
+			}
+			ahead.end = ahead.buffered();
+			ahead.begin = 0;
+			ahead.buffer = std::move(buffer);
+			ahead.charge = std::move(charge); // gives back the old buffer's
+			ahead.paused = false;
+			ec = error_code{};
+
+			const bool idle = std::holds_alternative<receiving_stream_state::expecting_body>(o.in);
+			if (!idle)
 			{
-				auto& o = *std::get_if<open>(&state);
-				sid = ::lsquic_stream_id(&o.handle);
-				ec = error_code{};
+				return false; // on_read() picks it up after the pending read
 			}
-			else
+			if (!ahead.enabled() || ahead.full() || ahead.eof || ahead.ec)
 			{
-				ec = make_error_code(errc::not_connected);
+				::lsquic_stream_wantread(&o.handle, 0);
+				return false;
 			}
-			return sid;
-		}
-
-		void connect(variant& state, stream_connect_operation& op)
-		{
-			assert(std::holds_alternative<closed>(state));
-			state = connecting{ &op };
+			::lsquic_stream_wantread(&o.handle, 1);
+			return true;
 		}
 
-		void on_connect(variant& state, lsquic_stream* handle, bool is_http)
+		// copy a corked write into the gather buffer. returns true once enough
+		// has piled up that it should go out now
+		static bool gather(open& o, stream_data_operation& op, size_t& bytes)
 		{
-			assert(std::holds_alternative<connecting>(state));
-			std::get_if<connecting>(&state)->op->defer(error_code{});
-			if (is_http)
+			auto& data = o.gather.data;
+			bytes = 0;
+			for (uint16_t i = 0; i < op.num_iovs; i++)
 			{
-				state.emplace<open>(*handle, open::h3_tag{});
+				const auto p = static_cast<const char*>(op.iovs[i].iov_base);
+				data.insert(data.end(), p, p + op.iovs[i].iov_len);
+				bytes += op.iovs[i].iov_len;
 			}
-			else
+			if (o.gather.pending() < sending_stream_state::cork::threshold)
 			{
-				state.emplace<open>(*handle, open::quic_tag{});
+				return false;
 			}
+			::lsquic_stream_wantwrite(&o.handle, 1);
+			return true;
 		}
 
-		void accept(variant& state, stream_accept_operation& op)
+		// hand gathered bytes to lsquic in one write and flush them. returns
+		// false if flow control left some of them behind
+		static bool write_gathered(sending_stream_state::cork& gather, lsquic_stream* handle)
 		{
-			assert(std::holds_alternative<closed>(state));
-			state = accepting{ &op };
+			while (gather.pending())
+			{
+				const auto bytes = ::lsquic_stream_write(handle,
+					gather.data.data() + gather.written, gather.pending());
+				if (bytes == -1)
+				{
+					break; // the stream is going away, on_close() reports it
+				}
+				if (bytes == 0)
+				{
+					return false;
+				}
+				gather.written += bytes;
+			}
+			gather.data.clear();
+			gather.written = 0;
+			::lsquic_stream_flush(handle);
+			return true;
 		}
 
-		void on_accept(variant& state, lsquic_stream* handle, bool is_http)
+		// write_gathered(), then send the FIN that shutdown() held back
+		static bool drain_gathered(open& o)
 		{
-			if (std::holds_alternative<accepting>(state))
+			if (!write_gathered(o.gather, &o.handle))
 			{
-				std::get_if<accepting>(&state)->op->defer(error_code{});
+				return false;
 			}
-			else
+			if (std::exchange(o.gather.fin, false))
 			{
-				assert(std::holds_alternative<closed>(state));
+				::lsquic_stream_shutdown(&o.handle, 1);
 			}
-			if (is_http)
+			return true;
+		}
+
+		bool write(variant& state, stream_data_operation& op)
+		{
+			if (std::holds_alternative<error>(state))
 			{
-				state.emplace<open>(*handle, open::h3_tag{});
+				op.post(std::get_if<error>(&state)->ec, 0);
+				state = closed{};
+				return false;
+			}
+			else if (std::holds_alternative<open>(state))
+			{
+				auto& o = *std::get_if<open>(&state);
+				if (o.gather.corked &&
+					o.gather.pending() < sending_stream_state::cork::threshold &&
+					std::holds_alternative<sending_stream_state::expecting_body>(o.out))
+				{
+					size_t bytes = 0;
+					const bool flush = gather(o, op, bytes);
+					op.post(error_code{}, bytes); // complete corked writes right away
+					return flush;
+				}
+				// past the threshold, this waits in on_write() behind the
+				// gathered bytes
+				sending_stream_state::write_body(o.out, &o.handle, op);
+				return true;
 			}
 			else
 			{
-				state.emplace<open>(*handle, open::quic_tag{});
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
+				return false;
 			}
 		}
 
-		bool read(variant& state, stream_data_operation& op)
+		bool write_all(variant& state, stream_data_operation& op)
 		{
 			if (std::holds_alternative<error>(state))
 			{
@@ -369,7 +1226,7 @@ namespace quic::detail
 			else if (std::holds_alternative<open>(state))
 			{
 				auto& o = *std::get_if<open>(&state);
-				receiving_stream_state::read_body(o.in, &o.handle, op);
+				sending_stream_state::write_body_all(o.out, &o.handle, op);
 				return true;
 			}
 			else
@@ -379,54 +1236,175 @@ namespace quic::detail
 			}
 		}
 
-		bool read_headers(variant& state, stream_header_read_operation& op)
+		bool write_fanout(variant& state, fanout_part& op)
 		{
 			if (std::holds_alternative<error>(state))
 			{
-				op.post(std::get_if<error>(&state)->ec);
+				op.post(std::get_if<error>(&state)->ec, 0);
 				state = closed{};
 				return false;
 			}
 			else if (std::holds_alternative<open>(state))
 			{
 				auto& o = *std::get_if<open>(&state);
-				receiving_stream_state::read_header(o.in, &o.handle, op);
+				sending_stream_state::write_fanout(o.out, &o.handle, op);
 				return true;
 			}
 			else
 			{
-				op.post(make_error_code(errc::bad_file_descriptor));
+				op.post(make_error_code(errc::bad_file_descriptor), 0);
 				return false;
 			}
 		}
 
-		void on_read(variant& state)
+		bool wait_read(variant& state, stream_wait_operation& op)
 		{
-			assert(std::holds_alternative<open>(state));
+			if (std::holds_alternative<error>(state))
+			{
+				op.post(std::get_if<error>(&state)->ec);
+				state = closed{};
+				return false;
+			}
+			else if (!std::holds_alternative<open>(state))
+			{
+				op.post(make_error_code(errc::bad_file_descriptor));
+				return false;
+			}
 			auto& o = *std::get_if<open>(&state);
-			receiving_stream_state::on_read(o.in, &o.handle);
-			::lsquic_stream_wantread(&o.handle, 0);
+			if (o.ahead.enabled() &&
+				std::holds_alternative<receiving_stream_state::expecting_body>(o.in) &&
+				(o.ahead.buffered() || o.ahead.eof || o.ahead.ec))
+			{
+				op.post(error_code{}); // readable from the read-ahead buffer
+				return false;
+			}
+			receiving_stream_state::wait(o.in, &o.handle, op);
+			return true;
 		}
 
-		bool write(variant& state, stream_data_operation& op)
+		bool wait_write(variant& state, stream_wait_operation& op)
 		{
 			if (std::holds_alternative<error>(state))
 			{
-				op.post(std::get_if<error>(&state)->ec, 0);
+				op.post(std::get_if<error>(&state)->ec);
 				state = closed{};
 				return false;
 			}
-			else if (std::holds_alternative<open>(state))
+			else if (!std::holds_alternative<open>(state))
 			{
-				auto& o = *std::get_if<open>(&state);
-				sending_stream_state::write_body(o.out, &o.handle, op);
-				return true;
+				op.post(make_error_code(errc::bad_file_descriptor));
+				return false;
 			}
-			else
+			auto& o = *std::get_if<open>(&state);
+			sending_stream_state::wait(o.out, &o.handle, op);
+			return true;
+		}
+
+		size_t try_read(variant& state, stream_data_operation& op, error_code& ec)
+		{
+			if (std::holds_alternative<error>(state))
 			{
-				op.post(make_error_code(errc::bad_file_descriptor), 0);
-				return false;
+				ec = std::get_if<error>(&state)->ec;
+				state = closed{};
+				return 0;
+			}
+			else if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::bad_file_descriptor);
+				return 0;
+			}
+			auto& o = *std::get_if<open>(&state);
+			if (!std::holds_alternative<receiving_stream_state::expecting_body>(o.in))
+			{
+				ec = make_error_code(errc::invalid_argument);
+				return 0;
+			}
+			o.reported = false;
+			if (o.watched)
+			{
+				// on_read() stopped watching when it reported the stream, and
+				// no read operation is left to turn it back on
+				::lsquic_stream_wantread(&o.handle, 1);
+			}
+			auto& ahead = o.ahead;
+			if (ahead.enabled() && (ahead.buffered() || ahead.eof || ahead.ec))
+			{
+				const size_t bytes = receiving_stream_state::drain_read_ahead(ahead, op);
+				ec = bytes ? error_code{} : ahead.ec;
+				if (ahead.paused && ahead.below_low_watermark())
+				{
+					ahead.paused = false;
+					::lsquic_stream_wantread(&o.handle, 1);
+				}
+				return bytes;
+			}
+			const auto bytes = ::lsquic_stream_readv(&o.handle, op.iovs, op.num_iovs);
+			if (bytes == -1)
+			{
+				if (errno == EWOULDBLOCK || errno == EAGAIN)
+				{
+					ec = make_error_code(errc::operation_would_block);
+				}
+				else
+				{
+					ec.assign(errno, system_category());
+				}
+				return 0;
 			}
+			ec = error_code{};
+			return bytes; // 0 at end of stream
+		}
+
+		size_t try_write(variant& state, stream_data_operation& op, error_code& ec)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				ec = std::get_if<error>(&state)->ec;
+				state = closed{};
+				return 0;
+			}
+			else if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::bad_file_descriptor);
+				return 0;
+			}
+			auto& o = *std::get_if<open>(&state);
+			if (std::holds_alternative<sending_stream_state::shutdown>(o.out))
+			{
+				ec = make_error_code(errc::bad_file_descriptor);
+				return 0;
+			}
+			if (!std::holds_alternative<sending_stream_state::expecting_body>(o.out))
+			{
+				ec = make_error_code(errc::invalid_argument);
+				return 0;
+			}
+			ec = error_code{};
+			if (o.gather.corked && o.gather.pending() < sending_stream_state::cork::threshold)
+			{
+				size_t bytes = 0;
+				gather(o, op, bytes);
+				return bytes;
+			}
+			if (o.gather.pending())
+			{
+				// corked bytes still ahead of this write
+				ec = make_error_code(errc::operation_would_block);
+				return 0;
+			}
+			const auto bytes = ::lsquic_stream_writev(&o.handle, op.iovs, op.num_iovs);
+			if (bytes == -1)
+			{
+				ec.assign(errno, system_category());
+				return 0;
+			}
+			if (bytes == 0)
+			{
+				ec = make_error_code(errc::operation_would_block);
+				return 0;
+			}
+			::lsquic_stream_flush(&o.handle);
+			return bytes;
 		}
 
 		bool write_headers(variant& state, stream_header_write_operation& op)
@@ -452,10 +1430,72 @@ namespace quic::detail
 
 		void on_write(variant& state)
 		{
+			if (std::holds_alternative<closing>(state))
+			{
+				// close() is waiting for its gathered bytes to go out
+				auto& c = *std::get_if<closing>(&state);
+				if (c.handle && write_gathered(c.gather, c.handle))
+				{
+					::lsquic_stream_close(std::exchange(c.handle, nullptr));
+				}
+				return;
+			}
 			assert(std::holds_alternative<open>(state));
 			auto& o = *std::get_if<open>(&state);
-			sending_stream_state::on_write(o.out, &o.handle);
-			::lsquic_stream_wantwrite(&o.handle, 0);
+			bool more = false;
+			if (o.gather.pending() && !drain_gathered(o))
+			{
+				more = true; // later writes stay queued behind the gathered bytes
+			}
+			else
+			{
+				more = sending_stream_state::on_write(o.out, &o.handle);
+			}
+			if (!more)
+			{
+				::lsquic_stream_wantwrite(&o.handle, 0);
+			}
+		}
+
+		void cork(variant& state, error_code& ec)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				ec = std::get_if<error>(&state)->ec;
+				state = closed{};
+				return;
+			}
+			else if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return;
+			}
+			std::get_if<open>(&state)->gather.corked = true;
+			ec = error_code{};
+		}
+
+		bool uncork(variant& state, error_code& ec)
+		{
+			if (std::holds_alternative<error>(state))
+			{
+				ec = std::get_if<error>(&state)->ec;
+				state = closed{};
+				return false;
+			}
+			else if (!std::holds_alternative<open>(state))
+			{
+				ec = make_error_code(errc::not_connected);
+				return false;
+			}
+			auto& o = *std::get_if<open>(&state);
+			o.gather.corked = false;
+			ec = error_code{};
+			if (!o.gather.pending())
+			{
+				return false;
+			}
+			::lsquic_stream_wantwrite(&o.handle, 1);
+			return true;
 		}
 
 		void flush(variant& state, error_code& ec)
@@ -472,6 +1512,10 @@ namespace quic::detail
 				return;
 			}
 			auto& o = *std::get_if<open>(&state);
+			if (o.gather.pending() && !drain_gathered(o))
+			{
+				::lsquic_stream_wantwrite(&o.handle, 1);
+			}
 			if (::lsquic_stream_flush(&o.handle) == -1)
 			{
 				ec.assign(errno, system_category());
@@ -494,14 +1538,26 @@ namespace quic::detail
 			}
 
 			auto& o = *std::get_if<open>(&state);
-			if (::lsquic_stream_shutdown(&o.handle, how) == -1)
+			const bool shutdown_write = (how == 1 || how == 2);
+			if (shutdown_write && o.gather.pending() && !write_gathered(o.gather, &o.handle))
+			{
+				// writes already completed from the gathered bytes, so the FIN
+				// waits in on_write() until flow control has taken all of them
+				o.gather.fin = true;
+				::lsquic_stream_wantwrite(&o.handle, 1);
+				if (how == 2 && ::lsquic_stream_shutdown(&o.handle, 0) == -1)
+				{
+					ec.assign(errno, system_category());
+					return;
+				}
+			}
+			else if (::lsquic_stream_shutdown(&o.handle, how) == -1)
 			{
 				ec.assign(errno, system_category());
 				return;
 			}
 			auto ecanceled = make_error_code(stream_error::aborted);
 			const bool shutdown_read = (how == 0 || how == 2);
-			const bool shutdown_write = (how == 1 || how == 2);
 			if (shutdown_read)
 			{
 				receiving_stream_state::cancel(o.in, ecanceled);
@@ -527,6 +1583,48 @@ namespace quic::detail
 			}
 		}
 
+		transition expire_read(variant& state, const void* op)
+		{
+			const auto ec = make_error_code(errc::timed_out);
+			if (std::holds_alternative<accepting>(state))
+			{
+				auto a = std::get_if<accepting>(&state)->op;
+				if (a && a == op)
+				{
+					a->defer(ec);
+					state = closed{};
+					return transition::accepting_to_closed;
+				}
+			}
+			else if (std::holds_alternative<connecting>(state))
+			{
+				auto c = std::get_if<connecting>(&state)->op;
+				if (c && c == op)
+				{
+					c->defer(ec);
+					state = closed{};
+					return transition::connecting_to_closed;
+				}
+			}
+			else if (std::holds_alternative<open>(state))
+			{
+				// the stream stays open. lsquic may still call on_read() once,
+				// which finds nothing pending and stops reading
+				auto& o = *std::get_if<open>(&state);
+				receiving_stream_state::expire(o.in, op, ec);
+			}
+			return transition::none;
+		}
+
+		void expire_write(variant& state, const void* op)
+		{
+			if (std::holds_alternative<open>(state))
+			{
+				auto& o = *std::get_if<open>(&state);
+				sending_stream_state::expire(o.out, op, make_error_code(errc::timed_out));
+			}
+		}
+
 		transition close(variant& state, stream_close_operation& op)
 		{
 			if (std::holds_alternative<closing>(state))
@@ -548,12 +1646,22 @@ namespace quic::detail
 				return transition::none;
 			}
 			auto& o = *std::get_if<open>(&state);
-			::lsquic_stream_close(&o.handle);
-
+			auto& handle = o.handle;
+			auto gather = std::move(o.gather);
 			auto ec = make_error_code(stream_error::aborted);
 			receiving_stream_state::cancel(o.in, ec);
 			sending_stream_state::cancel(o.out, ec);
 
+			if (gather.pending() && !write_gathered(gather, &handle))
+			{
+				// writes already completed from the gathered bytes, so the
+				// close waits in on_write() until all of them are written
+				::lsquic_stream_wantread(&handle, 0);
+				::lsquic_stream_wantwrite(&handle, 1);
+				state = closing{ &op, &handle, std::move(gather) };
+				return transition::open_to_closing;
+			}
+			::lsquic_stream_close(&handle);
 			state = closing{ &op };
 			return transition::open_to_closing;
 		}
@@ -652,9 +1760,16 @@ namespace quic::detail
 			}
 			if (std::holds_alternative<closing>(state))
 			{
-				if (auto op = std::get_if<closing>(&state)->op; op)
+				auto& c = *std::get_if<closing>(&state);
+				if (c.handle)
 				{
-					op->defer(ec);
+					// still writing gathered bytes, so lsquic has the stream open
+					::lsquic_stream_set_ctx(c.handle, nullptr);
+					::lsquic_stream_close(c.handle);
+				}
+				if (c.op)
+				{
+					c.op->defer(ec);
 				}
 				state = closed{};
 				return transition::closing_to_closed;
@@ -669,6 +1784,9 @@ namespace quic::detail
 				return transition::none;
 			}
 			auto& o = *std::get_if<open>(&state);
+			// lsquic may call on_close() later, when this may be destroyed or
+			// reopened on another lsquic stream
+			::lsquic_stream_set_ctx(&o.handle, nullptr);
 			::lsquic_stream_close(&o.handle);
 
 			receiving_stream_state::cancel(o.in, ec);
@@ -683,8 +1801,11 @@ namespace quic::detail
 			if (std::holds_alternative<accepting>(state))
 			{
 				auto& a = *std::get_if<accepting>(&state);
-				a.op->destroy(error_code{});
-				a.op = nullptr;
+				if (a.op)
+				{
+					a.op->destroy(error_code{});
+					a.op = nullptr;
+				}
 			}
 			else if (std::holds_alternative<connecting>(state))
 			{
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <variant>
+#include <vector>
 #include "../../asio_error_code.h"
 #include "../quic_stream_id.h"
+#include "memory_budget.h"
 
 struct lsquic_stream;
 
+namespace h3
+{
+	struct priority;
+}
+
 namespace quic::detail
 {
 
@@ -18,6 +25,8 @@ namespace quic::detail
 	struct stream_accept_operation;
 	struct stream_connect_operation;
 	struct stream_close_operation;
+	struct stream_wait_operation;
+	struct fanout_part;
 
 	namespace sending_stream_state
 	{
@@ -39,20 +48,60 @@ namespace quic::detail
 		{
 			data_operation* op = nullptr;
 		};
+		// the whole buffer sequence is pulled by lsquic_stream_writef() across
+		// as many on_write() callbacks as it takes, then completes once
+		struct body_all
+		{
+			data_operation* op = nullptr;
+		};
+		// a fan-out write's part, pulled from the shared payload like body_all
+		struct fanout
+		{
+			fanout_part* op = nullptr;
+		};
+		// async_wait(wait_write) until lsquic calls on_write()
+		struct waiting
+		{
+			stream_wait_operation* op = nullptr;
+		};
 		struct shutdown
 		{
 		};
 
 		using variant = std::variant<expecting_header, header,
-									 expecting_body, body,
-									 shutdown>;
+									 expecting_body, body, body_all,
+									 fanout, waiting, shutdown>;
+
+		// writes made while corked are copied here instead of going to lsquic
+		// one by one. the gathered bytes are handed over in a single write and
+		// flush on uncork, or once they reach the threshold. past the
+		// threshold, further writes wait for the gathered bytes to go out
+		struct cork
+		{
+			static constexpr size_t threshold = 64 * 1024;
+			std::vector<char> data;
+			size_t written = 0; // prefix of data already accepted by lsquic
+			bool corked = false;
+			bool fin = false; // shutdown(write) waits for the gathered bytes
+
+			size_t pending() const
+			{
+				return data.size() - written;
+			}
+		};
 
 		void write_header(variant& state, lsquic_stream* handle, header_operation& op);
 		void write_body(variant& state, lsquic_stream* handle, data_operation& op);
+		void write_body_all(variant& state, lsquic_stream* handle, data_operation& op);
+		void write_fanout(variant& state, lsquic_stream* handle, fanout_part& op);
+		void wait(variant& state, lsquic_stream* handle, stream_wait_operation& op);
 		void on_write_header(variant& state, lsquic_stream* handle);
 		void on_write_body(variant& state, lsquic_stream* handle);
-		void on_write(variant& state, lsquic_stream* handle);
+		bool on_write_body_all(variant& state, lsquic_stream* handle);
+		bool on_write(variant& state, lsquic_stream* handle); // true if more to write
 		int cancel(variant& state, error_code ec);
+		// complete `op` with ec if it's the one pending, leaving the stream usable
+		bool expire(variant& state, const void* op, error_code ec);
 		void destroy(variant& state);
 
 	} // namespace sending_stream_state
@@ -78,21 +127,67 @@ namespace quic::detail
 		{
 			data_operation* op = nullptr;
 		};
+		// one operation kept across on_read() callbacks until its buffers are
+		// full, or it has read op->minimum bytes
+		struct body_all
+		{
+			data_operation* op = nullptr;
+		};
+		// async_wait(wait_read) until lsquic calls on_read()
+		struct waiting
+		{
+			stream_wait_operation* op = nullptr;
+		};
 		struct shutdown
 		{
 		};
 
 		using variant = std::variant<expecting_header, header,
-									 expecting_body, body,
-									 shutdown>;
+									 expecting_body, body, body_all,
+									 waiting, shutdown>;
 
 
+		// optional per-stream read-ahead. while enabled, wantread stays on and
+		// lsquic is drained into the buffer until it reaches capacity (the high
+		// watermark). reads are served from here first without touching lsquic
+		struct read_ahead
+		{
+			std::vector<char> buffer; // size() is the high watermark
+			memory_charge charge; // for the buffer
+			size_t begin = 0;
+			size_t end = 0;
+			bool eof = false;
+			bool paused = false; // stopped draining at the high watermark
+			error_code ec;
+
+			bool enabled() const
+			{
+				return !buffer.empty();
+			}
+			size_t buffered() const
+			{
+				return end - begin;
+			}
+			bool full() const
+			{
+				return buffered() == buffer.size();
+			}
+			// resume draining lsquic once reads have taken it below half
+			bool below_low_watermark() const
+			{
+				return buffered() <= buffer.size() / 2;
+			}
+		};
+
 		void read_header(variant& state, lsquic_stream* handle, header_operation* op);
 		void read_body(variant& state, lsquic_stream* handle, data_operation* op);
+		void read_body_all(variant& state, lsquic_stream* handle, data_operation& op);
 		void on_read_header(variant& state, error_code ec);
 		void on_read_body(variant& state, error_code ec);
+		void wait(variant& state, lsquic_stream* handle, stream_wait_operation& op);
 		void on_read(variant& state, lsquic_stream* handle);
 		int cancel(variant& state, error_code ec);
+		bool expire(variant& state, const void* op, error_code ec);
 		void destroy(variant& state);
 
 	} // namespace receiving_stream_state
@@ -102,7 +197,7 @@ namespace quic::detail
 	{
 		struct accepting
 		{
-			stream_accept_operation* op = nullptr;
+			stream_accept_operation* op = nullptr; // null for batch accepts
 		};
 
 		struct connecting
@@ -116,6 +211,10 @@ namespace quic::detail
 
 			receiving_stream_state::variant in;
 			sending_stream_state::variant out;
+			receiving_stream_state::read_ahead ahead;
+			sending_stream_state::cork gather;
+			bool watched = false; // connection reports when this is readable
+			bool reported = false; // reported readable and not read since
 
 			struct quic_tag
 			{
@@ -141,6 +240,10 @@ namespace quic::detail
 		struct closing
 		{
 			stream_close_operation* op = nullptr;
+			// set while gathered bytes are still going out ahead of
+			// lsquic_stream_close()
+			lsquic_stream* handle = nullptr;
+			sending_stream_state::cork gather;
 		};
 
 		struct error
@@ -169,24 +272,56 @@ namespace quic::detail
 		bool is_open(const variant& state);
 		stream_id id(const variant& state, error_code& ec);
 
+		void set_priority(variant& state, unsigned priority, error_code& ec);
+		unsigned priority(const variant& state, error_code& ec);
+
+		void set_http_priority(variant& state, const h3::priority& prio, error_code& ec);
+		h3::priority http_priority(const variant& state, error_code& ec);
+
+		// streams are reusable: once closed, or failed along with their
+		// connection, they can be connected or accepted again
+		void reopen(variant& state, error_code& ec);
+
 		void connect(variant& state, stream_connect_operation& op);
 		void on_connect(variant& state, lsquic_stream* handle, bool is_http);
 
 		void accept(variant& state, stream_accept_operation& op);
+		void accept(variant& state); // part of a batch, completed by the connection
 		void on_accept(variant& state, lsquic_stream* handle, bool is_http);
 
 		bool read(variant& state, stream_data_operation& op);
+		bool read_all(variant& state, stream_data_operation& op);
 		bool read_headers(variant& state, stream_header_read_operation& op);
-		void on_read(variant& state);
+		bool on_read(variant& state);
+		bool set_read_ahead(variant& state, size_t bytes, memory_budget& budget, error_code& ec);
+		void watch_readable(variant& state);
 
 		bool write(variant& state, stream_data_operation& op);
+		bool write_all(variant& state, stream_data_operation& op);
+		bool write_fanout(variant& state, fanout_part& op);
+
+		bool wait_read(variant& state, stream_wait_operation& op);
+		bool wait_write(variant& state, stream_wait_operation& op);
+
+		// non-blocking reads and writes complete immediately, or fail with
+		// would_block instead of waiting for lsquic
+		size_t try_read(variant& state, stream_data_operation& op, error_code& ec);
+		size_t try_write(variant& state, stream_data_operation& op, error_code& ec);
 		bool write_headers(variant& state, stream_header_write_operation& op);
 		void on_write(variant& state);
 
+		void cork(variant& state, error_code& ec);
+		bool uncork(variant& state, error_code& ec);
+
 		void flush(variant& state, error_code& ec);
 		void shutdown(variant& state, int how, error_code& ec);
 		int cancel(variant& state, error_code ec);
 
+		// a deadline passed. fail `op` with timed_out if it's still pending.
+		// reads cover accept and connect, which happen before any read
+		transition expire_read(variant& state, const void* op);
+		void expire_write(variant& state, const void* op);
+
 		transition close(variant& state, stream_close_operation& op);
 		transition on_close(variant& state);
 		transition on_error(variant& state, error_code ec);
@@ -0,0 +1,101 @@
+#include "timer_impl.h"
+#include "engine_impl.h"
+
+namespace quic::detail
+{
+
+	timer_impl::timer_impl(engine_impl& engine)
+		: timer_wheel_entry(on_expire),
+		  engine(engine),
+		  svc(boost::asio::use_service<service<timer_impl>>(
+				  boost::asio::query(engine.get_executor(), boost::asio::execution::context)
+			  )
+		  )
+	{
+		svc.add(*this);
+	}
+
+	timer_impl::~timer_impl()
+	{
+		{
+			auto lock = std::unique_lock{ engine.mutex };
+			abort();
+		}
+		svc.remove(*this);
+	}
+
+	void timer_impl::service_shutdown()
+	{
+		if (op)
+		{
+			op->destroy(error_code{});
+			op = nullptr;
+		}
+	}
+
+	timer_impl::executor_type timer_impl::get_executor() const
+	{
+		return engine.get_executor();
+	}
+
+	deadline_clock::time_point timer_impl::expiry() const
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		return expiry_time;
+	}
+
+	size_t timer_impl::expires_at(deadline_clock::time_point t)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		const auto canceled = abort();
+		expiry_time = t;
+		return canceled;
+	}
+
+	size_t timer_impl::cancel()
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		return abort();
+	}
+
+	size_t timer_impl::abort()
+	{
+		if (!op)
+		{
+			return 0;
+		}
+		engine.deadlines.cancel(*this);
+		op->post(make_error_code(errc::operation_canceled));
+		op = nullptr;
+		return 1;
+	}
+
+	void timer_impl::wait(timer_wait_operation& op)
+	{
+		auto lock = std::unique_lock{ engine.mutex };
+		if (this->op)
+		{
+			op.post(make_error_code(errc::invalid_argument));
+			return;
+		}
+		if (expiry_time <= deadline_clock::now())
+		{
+			op.post(error_code{});
+			return;
+		}
+		this->op = &op;
+		engine.deadlines.schedule(*this, expiry_time);
+		engine.reschedule(lock);
+	}
+
+	void timer_impl::on_expire(timer_wheel_entry& e)
+	{
+		auto& t = static_cast<timer_impl&>(e);
+		if (t.op)
+		{
+			t.op->defer(error_code{});
+			t.op = nullptr;
+		}
+	}
+
+} // namespace quic::detail
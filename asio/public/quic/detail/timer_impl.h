@@ -0,0 +1,64 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include "operation.h"
+#include "service.h"
+#include "timer_wheel.h"
+
+namespace quic::detail
+{
+
+	struct engine_impl;
+
+	// a timer scheduled on its engine's timer_wheel instead of the
+	// io_context's timer queue. only a pending wait occupies the wheel
+	struct timer_impl : timer_wheel_entry, service_entry
+	{
+		using executor_type = boost::asio::any_io_executor;
+		engine_impl& engine;
+		service<timer_impl>& svc;
+		deadline_clock::time_point expiry_time;
+		timer_wait_operation* op = nullptr;
+
+		explicit timer_impl(engine_impl& engine);
+		~timer_impl();
+
+		void service_shutdown();
+
+		executor_type get_executor() const;
+
+		deadline_clock::time_point expiry() const;
+		size_t expires_at(deadline_clock::time_point t);
+		size_t cancel();
+
+		void wait(timer_wait_operation& op);
+		static void on_expire(timer_wheel_entry& e);
+
+		template<typename CompletionToken>
+		decltype(auto) async_wait(CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code)>(
+				[this](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = timer_wait_async<Handler, executor_type>;
+					auto p = handler_allocate<op_type>(h, std::move(h), get_executor());
+					auto op = handler_ptr<op_type, Handler>{ p, &p->handler };
+					wait(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+
+		void wait(error_code& ec)
+		{
+			timer_wait_sync op;
+			wait(op);
+			op.wait();
+			ec = std::get<0>(*op.result);
+		}
+	private:
+		size_t abort(); // with the engine mutex held
+	};
+
+} // namespace quic::detail
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <boost/intrusive/list.hpp>
+
+namespace quic::detail
+{
+
+	using deadline_clock = std::chrono::steady_clock;
+
+	// time_point::max() stands for no deadline
+	inline constexpr auto no_deadline = deadline_clock::time_point::max();
+
+	class timer_wheel;
+
+	using timer_wheel_hook = boost::intrusive::list_base_hook<
+		boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+
+	// something scheduled on a timer_wheel. expire() is called with the
+	// engine mutex held once the expiry has passed
+	struct timer_wheel_entry : timer_wheel_hook
+	{
+		deadline_clock::time_point expiry;
+		void (*expire)(timer_wheel_entry&) = nullptr;
+		std::atomic<timer_wheel*> wheel = nullptr; // written with the engine mutex held
+
+		explicit timer_wheel_entry(void (*expire)(timer_wheel_entry&)) noexcept
+			: expire(expire)
+		{
+		}
+		~timer_wheel_entry();
+
+		timer_wheel_entry(const timer_wheel_entry&) = delete;
+		timer_wheel_entry& operator=(const timer_wheel_entry&) = delete;
+
+		bool scheduled() const
+		{
+			return is_linked();
+		}
+		// for the entry's owner, without the engine mutex. nothing else
+		// schedules it, so a stale answer can only be a true one
+		bool maybe_scheduled() const noexcept
+		{
+			return wheel.load(std::memory_order_relaxed) != nullptr;
+		}
+	};
+
+	// a hashed hierarchical timer wheel with millisecond ticks. levels of
+	// 64 slots each cover 64^4 ms (about 4.6 hours) and anything further out
+	// waits in the top level until it cascades down. schedule() and cancel()
+	// are O(1), advance() touches only the slots it passes over
+	class timer_wheel
+	{
+	public:
+		using tick_duration = std::chrono::milliseconds;
+		static constexpr unsigned slot_bits = 6;
+		static constexpr uint64_t slots = uint64_t{ 1 } << slot_bits;
+		static constexpr uint64_t slot_mask = slots - 1;
+		static constexpr unsigned levels = 4;
+		static constexpr uint64_t range = uint64_t{ 1 } << (slot_bits * levels);
+	private:
+		using list = boost::intrusive::list<timer_wheel_entry,
+			boost::intrusive::constant_time_size<false>>;
+
+		std::array<std::array<list, slots>, levels> wheel;
+		deadline_clock::time_point origin = deadline_clock::now(); // tick 0
+		uint64_t now_tick = 0; // every tick before this has expired
+		size_t count = 0;
+
+		// round up so nothing expires early
+		uint64_t tick_ceil(deadline_clock::time_point t) const
+		{
+			if (t <= origin)
+			{
+				return 0;
+			}
+			const auto d = std::chrono::ceil<tick_duration>(t - origin);
+			return static_cast<uint64_t>(d.count());
+		}
+		uint64_t tick_floor(deadline_clock::time_point t) const
+		{
+			if (t <= origin)
+			{
+				return 0;
+			}
+			const auto d = std::chrono::floor<tick_duration>(t - origin);
+			return static_cast<uint64_t>(d.count());
+		}
+		deadline_clock::time_point tick_time(uint64_t tick) const
+		{
+			return origin + tick_duration{ tick };
+		}
+
+		void insert(timer_wheel_entry& e)
+		{
+			auto tick = std::max(tick_ceil(e.expiry), now_tick);
+			auto delta = tick - now_tick;
+			if (delta >= range)
+			{
+				delta = range - 1; // re-inserted as it cascades down
+				tick = now_tick + delta;
+			}
+			unsigned level = 0;
+			while (delta >= (uint64_t{ 1 } << (slot_bits * (level + 1))))
+			{
+				level++;
+			}
+			const auto slot = (tick >> (slot_bits * level)) & slot_mask;
+			wheel[level][slot].push_back(e);
+		}
+
+		// redistribute the slot of `level` that starts at now_tick
+		void cascade(unsigned level)
+		{
+			auto& l = wheel[level][(now_tick >> (slot_bits * level)) & slot_mask];
+			auto moving = list{};
+			moving.splice(moving.end(), l);
+			while (!moving.empty())
+			{
+				auto& e = moving.front();
+				moving.pop_front();
+				insert(e);
+			}
+		}
+	public:
+		timer_wheel() = default;
+		timer_wheel(const timer_wheel&) = delete;
+		timer_wheel& operator=(const timer_wheel&) = delete;
+
+		~timer_wheel()
+		{
+			for (auto& level : wheel)
+			{
+				for (auto& l : level)
+				{
+					while (!l.empty())
+					{
+						auto& e = l.front();
+						l.pop_front();
+						e.wheel.store(nullptr, std::memory_order_relaxed);
+					}
+				}
+			}
+		}
+
+		bool empty() const
+		{
+			return count == 0;
+		}
+
+		// schedule, or reschedule, an entry to expire at `expiry`
+		void schedule(timer_wheel_entry& e, deadline_clock::time_point expiry)
+		{
+			cancel(e);
+			e.expiry = expiry;
+			e.wheel.store(this, std::memory_order_relaxed);
+			insert(e);
+			count++;
+		}
+
+		void cancel(timer_wheel_entry& e)
+		{
+			if (e.is_linked())
+			{
+				e.unlink();
+				count--;
+			}
+			e.wheel.store(nullptr, std::memory_order_relaxed);
+		}
+
+		// a time at or before the earliest expiry, when advance() has work
+		std::optional<deadline_clock::time_point> next_expiry() const
+		{
+			if (count == 0)
+			{
+				return std::nullopt;
+			}
+			std::optional<uint64_t> next;
+			for (uint64_t i = 0; i < slots; i++)
+			{
+				if (!wheel[0][(now_tick + i) & slot_mask].empty())
+				{
+					next = now_tick + i;
+					break;
+				}
+			}
+			for (unsigned level = 1; level < levels; level++)
+			{
+				const auto shift = slot_bits * level;
+				const auto base = now_tick >> shift;
+				for (uint64_t i = 1; i <= slots; i++)
+				{
+					if (!wheel[level][(base + i) & slot_mask].empty())
+					{
+						const auto cascade_tick = (base + i) << shift;
+						if (!next || cascade_tick < *next)
+						{
+							next = cascade_tick;
+						}
+						break;
+					}
+				}
+			}
+			return tick_time(*next);
+		}
+
+		// expire everything due at `now`. expire() callbacks may schedule or
+		// cancel other entries
+		void advance(deadline_clock::time_point now)
+		{
+			const auto target = tick_floor(now);
+			auto expired = list{};
+			while (now_tick <= target)
+			{
+				if (count == 0)
+				{
+					now_tick = target + 1;
+					break;
+				}
+				for (unsigned level = 1; level < levels; level++)
+				{
+					const auto mask = (uint64_t{ 1 } << (slot_bits * level)) - 1;
+					if ((now_tick & mask) != 0)
+					{
+						break;
+					}
+					cascade(level);
+				}
+				auto& due = wheel[0][now_tick & slot_mask];
+				expired.splice(expired.end(), due);
+
+				// skip the empty level 0 slots up to the next cascade
+				auto next = now_tick + 1;
+				const auto boundary = (now_tick | slot_mask) + 1;
+				while (next < boundary && next <= target && wheel[0][next & slot_mask].empty())
+				{
+					next++;
+				}
+				now_tick = next;
+			}
+			while (!expired.empty())
+			{
+				auto& e = expired.front();
+				expired.pop_front();
+				count--;
+				e.wheel.store(nullptr, std::memory_order_relaxed);
+				e.expire(e);
+			}
+		}
+	};
+
+	inline timer_wheel_entry::~timer_wheel_entry()
+	{
+		if (auto w = wheel.load(std::memory_order_relaxed); w)
+		{
+			w->cancel(*this);
+		}
+	}
+
+} // namespace quic::detail
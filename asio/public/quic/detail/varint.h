@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// QUIC variable-length integers (RFC 9000, section 16). the top two bits of
+// the first byte give the encoded length of 1, 2, 4 or 8 bytes, and the
+// rest hold the value in network byte order
+namespace quic::detail::varint
+{
+
+	inline constexpr size_t max_size = 8;
+	inline constexpr uint64_t max_value = (uint64_t{ 1 } << 62) - 1;
+
+	inline constexpr size_t size(uint64_t value)
+	{
+		if (value < (1 << 6))
+		{
+			return 1;
+		}
+		if (value < (1 << 14))
+		{
+			return 2;
+		}
+		if (value < (1 << 30))
+		{
+			return 4;
+		}
+		return 8;
+	}
+
+	// writes size(value) bytes to `out`, and returns how many
+	inline size_t encode(uint64_t value, char* out)
+	{
+		const size_t n = size(value);
+		for (size_t i = n; i > 0; i--)
+		{
+			out[i - 1] = static_cast<char>(value & 0xff);
+			value >>= 8;
+		}
+		static constexpr unsigned char prefix[] = { 0, 0x40, 0, 0x80, 0, 0, 0, 0xc0 };
+		out[0] = static_cast<char>(static_cast<unsigned char>(out[0]) | prefix[n - 1]);
+		return n;
+	}
+
+	// reads a value from the first `n` bytes at `in`, and returns how many
+	// bytes it took. returns 0 if they end before the value does
+	inline size_t decode(const char* in, size_t n, uint64_t& value)
+	{
+		if (n == 0)
+		{
+			return 0;
+		}
+		const auto first = static_cast<unsigned char>(in[0]);
+		const size_t len = size_t{ 1 } << (first >> 6);
+		if (n < len)
+		{
+			return 0;
+		}
+		value = first & 0x3f;
+		for (size_t i = 1; i < len; i++)
+		{
+			value = (value << 8) | static_cast<unsigned char>(in[i]);
+		}
+		return len;
+	}
+
+} // namespace quic::detail::varint
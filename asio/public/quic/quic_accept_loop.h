@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include "quic_connection.h"
+#include "quic_stream.h"
+
+namespace quic
+{
+
+	namespace detail
+	{
+
+		template<typename Stream, typename Connection, typename Handler>
+		struct accept_loop_state
+		{
+			Connection& conn;
+			Handler handler;
+			bool stopped = false;
+
+			accept_loop_state(Connection& conn, Handler handler)
+				: conn(conn), handler(std::move(handler))
+			{
+			}
+
+			// accept into a fresh stream, and rearm once it completes
+			static void arm(std::shared_ptr<accept_loop_state> self)
+			{
+				auto s = std::make_unique<Stream>(self->conn);
+				auto& stream = *s;
+				self->conn.async_accept(stream,
+					[self, s = std::move(s)](error_code ec) mutable
+					{
+						if (self->stopped)
+						{
+							return;
+						}
+						if (ec)
+						{
+							self->stopped = true;
+							self->handler(ec, std::unique_ptr<Stream>{});
+							return;
+						}
+						self->handler(ec, std::move(s));
+						arm(std::move(self));
+					});
+			}
+		};
+
+	} // namespace detail
+
+	/// keep `depth` stream accepts outstanding on the connection, so a burst
+	/// of incoming streams doesn't wait on the handler to ask for the next
+	/// one. each accepted stream is passed to handler(error_code, unique_ptr)
+	/// and its slot rearmed. the loop stops at the first error, which reaches
+	/// the handler once with a null stream
+	template<typename Stream = stream, typename Connection, typename Handler>
+	void accept_loop(Connection& conn, size_t depth, Handler&& handler)
+	{
+		using state_type = detail::accept_loop_state<Stream, Connection, std::decay_t<Handler>>;
+		auto state = std::make_shared<state_type>(conn, std::forward<Handler>(handler));
+		for (size_t i = 0; i < depth; i++)
+		{
+			state_type::arm(state);
+		}
+	}
+
+} // namespace quic
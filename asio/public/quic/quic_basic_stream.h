@@ -0,0 +1,104 @@
+#pragma once
+
+#include "quic_stream.h"
+
+namespace quic
+{
+
+	/// a stream whose asynchronous operations use a concrete executor type
+	/// in place of any_io_executor, like
+	/// basic_stream<boost::asio::io_context::executor_type>. completion,
+	/// work tracking and the prefer/require queries then resolve at compile
+	/// time instead of going through the polymorphic executor. the engine's
+	/// executor must be of that type, or construction throws invalid_argument
+	template<typename Executor>
+	class basic_stream : public stream
+	{
+		Executor ex;
+
+		static Executor concrete(const stream::executor_type& any)
+		{
+			auto ex = any.template target<Executor>();
+			if (!ex)
+			{
+				throw system_error(make_error_code(errc::invalid_argument));
+			}
+			return *ex;
+		}
+	public:
+		using executor_type = Executor;
+
+		explicit basic_stream(connection& conn)
+			: stream(conn), ex(concrete(stream::get_executor()))
+		{
+		}
+
+		executor_type get_executor() const
+		{
+			return ex;
+		}
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read_some(const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_read_some(ex, buffers, std::forward<CompletionToken>(token));
+		}
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read_some(const MutableBufferSequence& buffers,
+			std::chrono::steady_clock::time_point deadline, CompletionToken&& token)
+		{
+			return impl.async_read_some(ex, buffers, deadline, std::forward<CompletionToken>(token));
+		}
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read(const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_read(ex, buffers, 0, std::forward<CompletionToken>(token));
+		}
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read(const MutableBufferSequence& buffers, size_t minimum, CompletionToken&& token)
+		{
+			return impl.async_read(ex, buffers, minimum, std::forward<CompletionToken>(token));
+		}
+
+		template<typename CompletionToken>
+		decltype(auto) async_wait(wait_type w, CompletionToken&& token)
+		{
+			return impl.async_wait(ex, w, std::forward<CompletionToken>(token));
+		}
+
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_some(const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_write_some(ex, buffers, std::forward<CompletionToken>(token));
+		}
+
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_some(const ConstBufferSequence& buffers,
+			std::chrono::steady_clock::time_point deadline, CompletionToken&& token)
+		{
+			return impl.async_write_some(ex, buffers, deadline, std::forward<CompletionToken>(token));
+		}
+
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_all(const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_write_all(ex, buffers, std::forward<CompletionToken>(token));
+		}
+
+		template<typename CompletionToken>
+		decltype(auto) async_send_file(int fd, off_t offset, size_t length, CompletionToken&& token)
+		{
+			return impl.async_send_file(ex, fd, offset, length, std::forward<CompletionToken>(token));
+		}
+
+		template<typename CompletionToken>
+		decltype(auto) async_close(CompletionToken&& token)
+		{
+			return impl.async_close(ex, std::forward<CompletionToken>(token));
+		}
+	};
+
+} // namespace quic
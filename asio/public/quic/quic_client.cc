@@ -40,6 +40,11 @@ namespace quic
 		return socket.local_endpoint();
 	}
 
+	memory_stats client::memory_stats() const
+	{
+		return engine.memory_stats();
+	}
+
 	void client::connect(connection& conn,
 		const udp::endpoint& endpoint,
 		const char* hostname)
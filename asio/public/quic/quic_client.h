@@ -29,6 +29,9 @@ namespace quic
 
 		udp::endpoint local_endpoint() const;
 
+		/// memory charged against settings::memory_budget
+		quic::memory_stats memory_stats() const;
+
 		void connect(connection& conn, const udp::endpoint& endpoint, const char* hostname);
 
 		void close(error_code& ec);
@@ -99,6 +99,80 @@ namespace quic
 		}
 	}
 
+	size_t connection::accept_some(std::span<stream> streams, error_code& ec)
+	{
+		auto op = detail::stream_accept_batch_sync{ detail::connection_impl::stream_impls(streams) };
+		impl.accept_some(op);
+		op.wait();
+		ec = std::get<0>(*op.result);
+		return std::get<1>(*op.result);
+	}
+
+	size_t connection::accept_some(std::span<stream> streams)
+	{
+		error_code ec;
+		const size_t n = accept_some(streams, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return n;
+	}
+
+	void connection::wait_readable(std::vector<stream_id>& ids, error_code& ec)
+	{
+		auto op = detail::readable_sync{ ids };
+		impl.wait_readable(op);
+		op.wait();
+		ec = std::get<0>(*op.result);
+	}
+
+	void connection::wait_readable(std::vector<stream_id>& ids)
+	{
+		error_code ec;
+		wait_readable(ids, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	void connection::set_datagram_queue_size(size_t size, error_code& ec)
+	{
+		impl.set_datagram_queue_size(size, ec);
+	}
+
+	void connection::set_datagram_queue_size(size_t size)
+	{
+		error_code ec;
+		impl.set_datagram_queue_size(size, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	quic::datagram_stats connection::datagram_stats(error_code& ec) const
+	{
+		return impl.datagram_stats(ec);
+	}
+
+	quic::datagram_stats connection::datagram_stats() const
+	{
+		error_code ec;
+		auto stats = impl.datagram_stats(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return stats;
+	}
+
+	size_t connection::memory_usage() const
+	{
+		return impl.memory_usage();
+	}
+
 	void connection::go_away(error_code& ec)
 	{
 		impl.go_away(ec);
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <span>
 #include "quic_connection_id.h"
+#include "quic_datagram.h"
+#include "quic_stream_id.h"
+#include "detail/awaitable.h"
 #include "detail/connection_impl.h"
 
 namespace quic
@@ -8,13 +12,17 @@ namespace quic
 
 	class acceptor;
 	class client;
+	class rpc_client;
 	class stream;
+	class wheel_timer;
 
 	class connection
 	{
 		friend class acceptor;
 		friend class client;
+		friend class rpc_client;
 		friend class stream;
+		friend class wheel_timer;
 		friend class detail::socket_impl;
 		detail::connection_impl impl;
 	public:
@@ -40,6 +48,15 @@ namespace quic
 			return impl.async_connect<stream>(s, std::forward<CompletionToken>(token));
 		}
 
+		/// fails with errc::timed_out and leaves the stream closed if it wasn't
+		/// opened by the deadline, like while waiting for the peer's stream limit
+		template<typename CompletionToken>
+		decltype(auto) async_connect(stream& s, std::chrono::steady_clock::time_point deadline,
+			CompletionToken&& token)
+		{
+			return impl.async_connect<stream>(s, deadline, std::forward<CompletionToken>(token));
+		}
+
 		void connect(stream& s, error_code& ec);
 		void connect(stream& s);
 
@@ -49,14 +66,118 @@ namespace quic
 			return impl.async_accept<stream>(s, std::forward<CompletionToken>(token));
 		}
 
+		/// fails with errc::timed_out if no stream arrived by the deadline
+		template<typename CompletionToken>
+		decltype(auto) async_accept(stream& s, std::chrono::steady_clock::time_point deadline,
+			CompletionToken&& token)
+		{
+			return impl.async_accept<stream>(s, deadline, std::forward<CompletionToken>(token));
+		}
+
 		void accept(stream& s, error_code& ec);
 		void accept(stream& s);
 
+		/// accept up to one incoming stream per element of `streams`, which
+		/// must all be closed. everything already queued is taken at once;
+		/// otherwise it waits for the next streams to arrive. completes with
+		/// the number n of streams accepted, which are the first n elements
+		template<typename StreamRange, typename CompletionToken>
+		decltype(auto) async_accept_some(StreamRange&& streams, CompletionToken&& token)
+		{
+			return impl.async_accept_some(std::forward<StreamRange>(streams),
+										  std::forward<CompletionToken>(token));
+		}
+
+		size_t accept_some(std::span<stream> streams, error_code& ec);
+		size_t accept_some(std::span<stream> streams);
+
+		/// awaitable versions of async_connect() and async_accept() for C++20
+		/// coroutines, keeping the operation in the coroutine frame. co_await
+		/// throws system_error on failure, unless given an error_code
+		template<typename Stream = stream>
+		auto co_connect(Stream& s, error_code* ec = nullptr)
+		{
+			return connect_awaiter{ impl, &detail::connection_impl::connect, ec,
+									detail::no_prepare{}, s.impl };
+		}
+
+		template<typename Stream = stream>
+		auto co_connect(Stream& s, error_code& ec)
+		{
+			return co_connect(s, &ec);
+		}
+
+		template<typename Stream = stream>
+		auto co_accept(Stream& s, error_code* ec = nullptr)
+		{
+			return accept_awaiter{ impl, &detail::connection_impl::accept, ec,
+								   detail::no_prepare{}, s.impl };
+		}
+
+		template<typename Stream = stream>
+		auto co_accept(Stream& s, error_code& ec)
+		{
+			return co_accept(s, &ec);
+		}
+
+		/// wait until at least one of the connection's streams has data to read,
+		/// then replace `ids` with every stream that became readable. streams
+		/// are watched from the first call on, without parking a read on each
+		/// one. a stream is reported once and again only after it's been read
+		template<typename CompletionToken>
+		decltype(auto) async_wait_readable(std::vector<stream_id>& ids, CompletionToken&& token)
+		{
+			return impl.async_wait_readable(ids, std::forward<CompletionToken>(token));
+		}
+
+		void wait_readable(std::vector<stream_id>& ids, error_code& ec);
+		void wait_readable(std::vector<stream_id>& ids);
+
+		/// queue an unreliable datagram for sending. it completes as soon as the
+		/// datagram is queued; when the queue is full, the oldest queued datagram
+		/// is dropped. fails with message_size if it can't fit in a packet,
+		/// no_buffer_space past the engine's memory budget, or
+		/// operation_not_supported unless both peers enabled settings::datagrams
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_send_datagram(const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_send_datagram(buffers, std::forward<CompletionToken>(token));
+		}
+
+		/// receive the next datagram. datagrams that arrive with no receive
+		/// pending are queued, dropping the oldest when the queue is full. a
+		/// datagram larger than the buffers is truncated with message_size
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_receive_datagram(const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_receive_datagram(buffers, std::forward<CompletionToken>(token));
+		}
+
+		/// limit each datagram queue to `size` entries (default 64)
+		void set_datagram_queue_size(size_t size, error_code& ec);
+		void set_datagram_queue_size(size_t size);
+
+		quic::datagram_stats datagram_stats(error_code& ec) const;
+		quic::datagram_stats datagram_stats() const;
+
+		/// bytes this library holds for the connection: the connection itself,
+		/// its queue of unaccepted streams and any datagram queues. streams
+		/// are counted with their stream objects, not here. lsquic's own
+		/// per-connection state isn't reported by its API, so its share is
+		/// only visible in process-wide figures like bench_idle_connections
+		/// reports. an open connection without streams or datagrams holds
+		/// nothing beyond sizeof(connection)
+		size_t memory_usage() const;
+
 		void go_away(error_code& ec);
 		void go_away();
 
 		void close(error_code& ec);
 		void close();
+
+	private:
+		using connect_awaiter = detail::operation_awaiter<detail::connection_impl, detail::stream_connect_operation>;
+		using accept_awaiter = detail::operation_awaiter<detail::connection_impl, detail::stream_accept_operation>;
 	};
 
 } // namespace quic
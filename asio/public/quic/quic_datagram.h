@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace quic
+{
+
+	/// counters for a connection's DATAGRAM traffic
+	struct datagram_stats
+	{
+		uint64_t sent = 0; // handed to lsquic
+		uint64_t received = 0; // delivered from lsquic
+		uint64_t dropped_outgoing = 0; // pushed out of a full send queue
+		uint64_t dropped_incoming = 0; // pushed out of a full receive queue
+		uint64_t oversized = 0; // too large to fit in a packet
+	};
+
+} // namespace quic
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "../asio_error_code.h"
+#include "detail/connection_impl.h"
+
+namespace quic
+{
+
+	/// an immutable payload shared by every stream of a fan-out write
+	using shared_payload = std::shared_ptr<const std::vector<char>>;
+
+	/// write all of `payload` to each stream in `streams`, which may belong to
+	/// different connections. lsquic reads every stream's data straight from
+	/// the one shared payload, which is kept alive until the write completes.
+	/// streams on the same engine are started under a single lock and engine
+	/// pass. completes once, with the first failure (if any) and each
+	/// stream's result in the order given. every stream must be idle for
+	/// writing, as for async_write_all(). the handler runs on its associated
+	/// executor, or on `ex` if it has none
+	template<typename Executor, typename StreamRange, typename CompletionToken>
+	decltype(auto) async_write_fanout(const Executor& ex, StreamRange&& streams,
+		shared_payload payload, CompletionToken&& token)
+	{
+		return detail::stream_impl::async_write_fanout(detail::stream_impl::executor_type{ ex },
+			detail::connection_impl::stream_impls(streams), std::move(payload),
+			std::forward<CompletionToken>(token));
+	}
+
+	/// blocks until every stream has taken the payload, and returns their results
+	template<typename StreamRange>
+	std::vector<error_code> write_fanout(StreamRange&& streams, shared_payload payload)
+	{
+		return detail::stream_impl::write_fanout(
+			detail::connection_impl::stream_impls(streams), std::move(payload));
+	}
+
+} // namespace quic
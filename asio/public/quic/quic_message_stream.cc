@@ -0,0 +1,219 @@
+#include <cstring>
+
+#include "quic_message_stream.h"
+#include "detail/varint.h"
+
+namespace quic
+{
+
+	message_stream::message_stream(stream& s, size_t max_message_size)
+		: s(s), max_message_size(max_message_size), input(input_size)
+	{
+	}
+
+	void message_stream::recycle(message&& m)
+	{
+		if (pool.size() < max_pooled)
+		{
+			m.clear();
+			pool.push_back(std::move(m));
+		}
+	}
+
+	message_stream::message message_stream::acquire(size_t size)
+	{
+		if (pool.empty())
+		{
+			return message(size);
+		}
+		auto m = std::move(pool.back());
+		pool.pop_back();
+		m.resize(size);
+		return m;
+	}
+
+	error_code message_stream::parse(std::vector<message>& messages)
+	{
+		while (begin < end)
+		{
+			const size_t avail = end - begin;
+			uint64_t length = 0;
+			const size_t prefix = detail::varint::decode(input.data() + begin, avail, length);
+			if (prefix == 0)
+			{
+				break; // wait for the rest of the prefix
+			}
+			if (length > max_message_size)
+			{
+				return make_error_code(errc::message_size);
+			}
+			if (avail - prefix >= length)
+			{
+				auto m = acquire(length);
+				::memcpy(m.data(), input.data() + begin + prefix, length);
+				messages.push_back(std::move(m));
+				begin += prefix + length;
+				continue;
+			}
+			if (prefix + length > input.size())
+			{
+				// too big for the input buffer. the rest goes straight into it
+				pending = acquire(length);
+				pending_filled = avail - prefix;
+				::memcpy(pending.data(), input.data() + begin + prefix, pending_filled);
+				has_pending = true;
+				begin = end = 0;
+			}
+			break;
+		}
+		if (begin == end)
+		{
+			begin = end = 0;
+		}
+		return error_code{};
+	}
+
+	boost::asio::mutable_buffer message_stream::read_target()
+	{
+		if (has_pending)
+		{
+			return boost::asio::buffer(pending.data() + pending_filled, pending.size() - pending_filled);
+		}
+		if (begin > 0)
+		{
+			::memmove(input.data(), input.data() + begin, end - begin);
+			end -= begin;
+			begin = 0;
+		}
+		return boost::asio::buffer(input.data() + end, input.size() - end);
+	}
+
+	error_code message_stream::on_read(size_t bytes, std::vector<message>& messages)
+	{
+		if (bytes == 0) // the peer shut down its side
+		{
+			if (has_pending || begin < end)
+			{
+				return make_error_code(errc::bad_message); // cut off mid-message
+			}
+			return make_error_code(stream_error::eof);
+		}
+		if (has_pending)
+		{
+			pending_filled += bytes;
+			if (pending_filled == pending.size())
+			{
+				messages.push_back(std::move(pending));
+				pending = message{};
+				has_pending = false;
+			}
+			return error_code{};
+		}
+		end += bytes;
+		return parse(messages);
+	}
+
+	size_t message_stream::prepare(std::span<const boost::asio::const_buffer> messages)
+	{
+		coalesced.clear();
+		segments.clear();
+		segments_sent = 0;
+
+		// reserve up front so the segments can point into `coalesced`
+		size_t copied = 0;
+		size_t total = 0;
+		for (const auto& m : messages)
+		{
+			const size_t prefix = detail::varint::size(m.size());
+			copied += prefix + (m.size() <= coalesce_limit ? m.size() : 0);
+			total += prefix + m.size();
+		}
+		coalesced.reserve(copied);
+
+		size_t run = 0; // start of the coalesced bytes not yet in a segment
+		for (const auto& m : messages)
+		{
+			char prefix[detail::varint::max_size];
+			const size_t n = detail::varint::encode(m.size(), prefix);
+			coalesced.insert(coalesced.end(), prefix, prefix + n);
+			const auto data = static_cast<const char*>(m.data());
+			if (m.size() <= coalesce_limit)
+			{
+				coalesced.insert(coalesced.end(), data, data + m.size());
+				continue;
+			}
+			segments.push_back(boost::asio::buffer(coalesced.data() + run, coalesced.size() - run));
+			segments.push_back(m);
+			run = coalesced.size();
+		}
+		if (coalesced.size() > run)
+		{
+			segments.push_back(boost::asio::buffer(coalesced.data() + run, coalesced.size() - run));
+		}
+		return total;
+	}
+
+	std::span<const boost::asio::const_buffer> message_stream::next_segments() const
+	{
+		// as many as one write operation takes
+		const size_t count = std::min<size_t>(segments.size() - segments_sent,
+			detail::stream_data_operation::max_iovs);
+		return std::span<const boost::asio::const_buffer>{ segments }.subspan(segments_sent, count);
+	}
+
+	size_t message_stream::receive(std::vector<message>& messages, error_code& ec)
+	{
+		const size_t first = messages.size();
+		ec = parse(messages);
+		while (!ec && messages.size() == first)
+		{
+			const size_t bytes = s.read_some(read_target(), ec);
+			if (ec)
+			{
+				return 0;
+			}
+			ec = on_read(bytes, messages);
+		}
+		return messages.size() - first;
+	}
+
+	size_t message_stream::receive(std::vector<message>& messages)
+	{
+		error_code ec;
+		const size_t count = receive(messages, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return count;
+	}
+
+	size_t message_stream::send(std::span<const boost::asio::const_buffer> messages, error_code& ec)
+	{
+		const size_t total = prepare(messages);
+		size_t sent = 0;
+		while (segments_sent < segments.size())
+		{
+			const auto chunk = next_segments();
+			sent += s.write_all(chunk, ec);
+			if (ec)
+			{
+				return sent;
+			}
+			segments_sent += chunk.size();
+		}
+		return total;
+	}
+
+	size_t message_stream::send(std::span<const boost::asio::const_buffer> messages)
+	{
+		error_code ec;
+		const size_t bytes = send(messages, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return bytes;
+	}
+
+} // namespace quic
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/post.hpp>
+#include "quic_stream.h"
+
+namespace quic
+{
+
+	/// a message-oriented adapter over a stream. each message goes out as
+	/// its length, encoded as a QUIC variable-length integer, followed by
+	/// that many bytes. a batch of messages is sent as one vectored write,
+	/// with the prefixes and any small messages copied together so lsquic
+	/// takes them in a single call. received messages come in buffers from
+	/// a pool, sized from their prefixes, and one receive hands over every
+	/// message that has fully arrived. one send and one receive may be
+	/// pending at a time. the adapter must not outlive its stream
+	class message_stream
+	{
+	public:
+		using message = std::vector<char>;
+
+		static constexpr size_t default_max_message_size = 16 * 1024 * 1024;
+		static constexpr size_t input_size = 64 * 1024;
+		static constexpr size_t coalesce_limit = 1024; // copied rather than referenced
+		static constexpr size_t max_pooled = 64;
+	private:
+		stream& s;
+		size_t max_message_size;
+
+		// receiving
+		std::vector<char> input;
+		size_t begin = 0;
+		size_t end = 0;
+		message pending; // a message too large for `input`, read into directly
+		size_t pending_filled = 0;
+		bool has_pending = false;
+		std::vector<message> pool;
+
+		// sending
+		std::vector<char> coalesced;
+		std::vector<boost::asio::const_buffer> segments;
+		size_t segments_sent = 0;
+
+		message acquire(size_t size);
+		error_code parse(std::vector<message>& messages);
+		boost::asio::mutable_buffer read_target();
+		error_code on_read(size_t bytes, std::vector<message>& messages);
+
+		size_t prepare(std::span<const boost::asio::const_buffer> messages);
+		std::span<const boost::asio::const_buffer> next_segments() const;
+
+		enum class step { start, finish, io };
+	public:
+		explicit message_stream(stream& s, size_t max_message_size = default_max_message_size);
+
+		message_stream(const message_stream&) = delete;
+		message_stream& operator=(const message_stream&) = delete;
+
+		using executor_type = stream::executor_type;
+		executor_type get_executor() const
+		{
+			return s.get_executor();
+		}
+
+		stream& next_layer()
+		{
+			return s;
+		}
+
+		/// return a received message's buffer to the pool
+		void recycle(message&& m);
+
+		/// append every message that has arrived to `messages`, waiting for
+		/// at least one. completes with the number appended. a message longer
+		/// than max_message_size fails with errc::message_size. once the peer
+		/// shuts down its side, fails with stream_error::eof, or with
+		/// errc::bad_message if that cut a message short
+		template<typename CompletionToken>
+		decltype(auto) async_receive(std::vector<message>& messages, CompletionToken&& token)
+		{
+			return boost::asio::async_compose<CompletionToken, void(error_code, size_t)>(
+				[this, &messages, first = messages.size(), at = step::start, result = error_code{}]
+				(auto& self, error_code ec = {}, size_t bytes = 0) mutable
+				{
+					switch (at)
+					{
+					case step::start:
+						result = parse(messages);
+						if (result || messages.size() > first)
+						{
+							at = step::finish; // don't complete inside the initiating call
+							boost::asio::post(s.get_executor(), std::move(self));
+							return;
+						}
+						break;
+					case step::finish:
+						self.complete(result, messages.size() - first);
+						return;
+					case step::io:
+						if (ec)
+						{
+							self.complete(ec, 0);
+							return;
+						}
+						result = on_read(bytes, messages);
+						if (result || messages.size() > first)
+						{
+							self.complete(result, messages.size() - first);
+							return;
+						}
+						break;
+					}
+					at = step::io;
+					s.async_read_some(read_target(), std::move(self));
+				}, token, s);
+		}
+
+		size_t receive(std::vector<message>& messages, error_code& ec);
+		size_t receive(std::vector<message>& messages);
+
+		/// send a batch of messages. completes with the bytes written,
+		/// including the length prefixes
+		template<typename CompletionToken>
+		decltype(auto) async_send(std::span<const boost::asio::const_buffer> messages, CompletionToken&& token)
+		{
+			return boost::asio::async_compose<CompletionToken, void(error_code, size_t)>(
+				[this, messages, at = step::start, total = size_t{ 0 }, sent = size_t{ 0 }]
+				(auto& self, error_code ec = {}, size_t bytes = 0) mutable
+				{
+					switch (at)
+					{
+					case step::start:
+						total = prepare(messages);
+						if (segments.empty())
+						{
+							at = step::finish;
+							boost::asio::post(s.get_executor(), std::move(self));
+							return;
+						}
+						break;
+					case step::finish:
+						self.complete(error_code{}, total);
+						return;
+					case step::io:
+						sent += bytes;
+						if (ec)
+						{
+							self.complete(ec, sent);
+							return;
+						}
+						segments_sent += next_segments().size();
+						if (segments_sent == segments.size())
+						{
+							self.complete(error_code{}, total);
+							return;
+						}
+						break;
+					}
+					at = step::io;
+					s.async_write_all(next_segments(), std::move(self));
+				}, token, s);
+		}
+
+		size_t send(std::span<const boost::asio::const_buffer> messages, error_code& ec);
+		size_t send(std::span<const boost::asio::const_buffer> messages);
+	};
+
+} // namespace quic
@@ -0,0 +1,262 @@
+#include <algorithm>
+
+#include "quic_rpc.h"
+#include "detail/engine_impl.h"
+#include "detail/socket_impl.h"
+
+namespace quic
+{
+
+	namespace detail
+	{
+
+		rpc_lane::rpc_lane(std::unique_ptr<stream> s, size_t max_message_size)
+			: s(std::move(s)), messages(*this->s, max_message_size)
+		{
+		}
+
+		rpc_lane::~rpc_lane() = default;
+
+		void rpc_lane::start()
+		{
+			open = true;
+			read();
+			flush();
+		}
+
+		void rpc_lane::fail(error_code ec)
+		{
+			if (failed)
+			{
+				return;
+			}
+			failed = ec;
+			open = false;
+			queued.clear();
+			s->reset(); // pending reads and writes complete with errors
+			on_error(ec);
+		}
+
+		void rpc_lane::send(uint64_t id, boost::asio::const_buffer body)
+		{
+			auto f = frame{};
+			f.body = body;
+			queue(id, std::move(f));
+		}
+
+		void rpc_lane::send(uint64_t id, std::vector<char>&& body)
+		{
+			auto f = frame{};
+			f.owned = std::move(body);
+			f.body = boost::asio::buffer(f.owned);
+			queue(id, std::move(f)); // moving the vector keeps its data in place
+		}
+
+		void rpc_lane::queue(uint64_t id, frame&& f)
+		{
+			if (failed)
+			{
+				return;
+			}
+			const size_t length = varint::size(id) + f.body.size();
+			f.header_size = varint::encode(length, f.header.data());
+			f.header_size += varint::encode(id, f.header.data() + f.header_size);
+			queued.push_back(std::move(f));
+			flush();
+		}
+
+		void rpc_lane::read()
+		{
+			messages.async_receive(received, [self = shared_from_this()](error_code ec, size_t)
+			{
+				if (self->failed)
+				{
+					return;
+				}
+				if (ec)
+				{
+					self->fail(ec);
+					return;
+				}
+				for (auto& m : self->received)
+				{
+					uint64_t id = 0;
+					const size_t n = varint::decode(m.data(), m.size(), id);
+					if (n == 0)
+					{
+						self->fail(make_error_code(errc::bad_message));
+						return;
+					}
+					self->on_message(id, rpc_message{ std::move(m), n });
+					if (self->failed)
+					{
+						return;
+					}
+				}
+				self->received.clear();
+				self->read();
+			});
+		}
+
+		void rpc_lane::flush()
+		{
+			if (write_pending || !open || queued.empty())
+			{
+				return;
+			}
+			// the headers are built in place, so take the segments only once
+			// the frames stop moving
+			writing.clear();
+			std::swap(queued, writing);
+			segments.clear();
+			segments_sent = 0;
+			for (auto& f : writing)
+			{
+				segments.push_back(boost::asio::buffer(f.header.data(), f.header_size));
+				if (f.body.size())
+				{
+					segments.push_back(f.body);
+				}
+			}
+			write_pending = true;
+			write_next();
+		}
+
+		void rpc_lane::write_next()
+		{
+			const size_t count = std::min<size_t>(segments.size() - segments_sent,
+				stream_data_operation::max_iovs);
+			const auto chunk = std::span<const boost::asio::const_buffer>{ segments }
+				.subspan(segments_sent, count);
+			s->async_write_all(chunk, [self = shared_from_this(), count](error_code ec, size_t)
+			{
+				if (self->failed)
+				{
+					return;
+				}
+				if (ec)
+				{
+					self->write_pending = false;
+					self->fail(ec);
+					return;
+				}
+				self->segments_sent += count;
+				if (self->segments_sent < self->segments.size())
+				{
+					self->write_next();
+					return;
+				}
+				self->write_pending = false;
+				self->writing.clear();
+				self->flush();
+			});
+		}
+
+		void rpc_client_lane::connect(connection& conn)
+		{
+			conn.async_connect(*s, [self = shared_from_this()](error_code ec)
+			{
+				if (self->failed)
+				{
+					return;
+				}
+				if (ec)
+				{
+					self->fail(ec);
+					return;
+				}
+				self->start();
+			});
+		}
+
+		void rpc_client_lane::call(uint64_t id, rpc_call_operation& op)
+		{
+			calls.emplace(id, &op);
+			send(id, op.request);
+		}
+
+		void rpc_client_lane::on_message(uint64_t id, rpc_message&& m)
+		{
+			auto i = calls.find(id);
+			if (i == calls.end())
+			{
+				return; // not ours
+			}
+			auto op = i->second;
+			calls.erase(i);
+			op->post(error_code{}, std::move(m));
+		}
+
+		void rpc_client_lane::on_error(error_code ec)
+		{
+			auto failing = std::move(calls);
+			calls.clear();
+			for (auto& [id, op] : failing)
+			{
+				op->post(ec, rpc_message{});
+			}
+		}
+
+	} // namespace detail
+
+	rpc_client::rpc_client(connection& conn, size_t streams, size_t max_message_size)
+		: conn(conn), max_message_size(max_message_size)
+	{
+		const size_t limit = conn.impl._socket.engine.max_streams_per_connection;
+		streams = std::clamp<size_t>(streams, 1, std::max<size_t>(limit, 1));
+		lanes.reserve(streams);
+		for (size_t i = 0; i < streams; i++)
+		{
+			lanes.push_back(open_lane());
+		}
+	}
+
+	rpc_client::~rpc_client()
+	{
+		for (auto& lane : lanes)
+		{
+			lane->fail(make_error_code(errc::operation_canceled));
+		}
+	}
+
+	std::shared_ptr<detail::rpc_client_lane> rpc_client::open_lane()
+	{
+		auto lane = std::make_shared<detail::rpc_client_lane>(
+			std::make_unique<stream>(conn), max_message_size);
+		lane->connect(conn);
+		return lane;
+	}
+
+	detail::rpc_client_lane* rpc_client::pick()
+	{
+		detail::rpc_client_lane* best = nullptr;
+		for (auto& lane : lanes)
+		{
+			if (lane->failed)
+			{
+				if (!conn.is_open())
+				{
+					continue;
+				}
+				lane = open_lane();
+			}
+			if (!best || lane->calls.size() < best->calls.size())
+			{
+				best = lane.get();
+			}
+		}
+		return best;
+	}
+
+	void rpc_client::call(detail::rpc_call_operation& op)
+	{
+		auto lane = pick();
+		if (!lane)
+		{
+			op.post(make_error_code(errc::not_connected), rpc_message{});
+			return;
+		}
+		lane->call(next_id++, op);
+	}
+
+} // namespace quic
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "quic_accept_loop.h"
+#include "quic_connection.h"
+#include "quic_message_stream.h"
+#include "quic_stream.h"
+#include "detail/handler_ptr.h"
+#include "detail/operation.h"
+#include "detail/varint.h"
+
+namespace quic
+{
+
+	/// a request or response as received. `data` still starts with the call
+	/// id, which is skipped rather than erased so the body never moves
+	struct rpc_message
+	{
+		std::vector<char> data;
+		size_t offset = 0; // where the body starts
+
+		std::span<const char> body() const
+		{
+			return std::span<const char>{ data }.subspan(offset);
+		}
+	};
+
+	namespace detail
+	{
+
+		struct rpc_call_operation : operation<error_code, rpc_message>
+		{
+			boost::asio::const_buffer request;
+
+			rpc_call_operation(complete_fn complete, boost::asio::const_buffer request) noexcept
+				: operation(complete), request(request)
+			{
+			}
+		};
+
+		template<typename Handler, typename IoExecutor>
+		using rpc_call_async = async_operation<rpc_call_operation, Handler, IoExecutor>;
+
+		// a stream carrying rpc frames both ways. each frame is a message of
+		// message_stream framing that starts with the call id as a varint.
+		// frames queued while a write is in flight go out together in the
+		// next one, every header next to its body
+		struct rpc_lane : std::enable_shared_from_this<rpc_lane>
+		{
+			struct frame
+			{
+				std::array<char, 2 * varint::max_size> header;
+				size_t header_size = 0;
+				std::vector<char> owned;
+				boost::asio::const_buffer body;
+			};
+
+			std::unique_ptr<stream> s;
+			message_stream messages;
+			std::vector<message_stream::message> received;
+			std::vector<frame> queued;
+			std::vector<frame> writing;
+			std::vector<boost::asio::const_buffer> segments;
+			size_t segments_sent = 0;
+			bool write_pending = false;
+			bool open = false;
+			error_code failed; // set once the lane is unusable
+
+			rpc_lane(std::unique_ptr<stream> s, size_t max_message_size);
+			virtual ~rpc_lane();
+
+			rpc_lane(const rpc_lane&) = delete;
+			rpc_lane& operator=(const rpc_lane&) = delete;
+
+			// start reading, and writing whatever was queued before
+			void start();
+			void fail(error_code ec);
+
+			// `body` must stay valid until the frame is written or the lane fails
+			void send(uint64_t id, boost::asio::const_buffer body);
+			void send(uint64_t id, std::vector<char>&& body);
+
+			virtual void on_message(uint64_t id, rpc_message&& m) = 0;
+			virtual void on_error(error_code ec) = 0;
+		private:
+			void queue(uint64_t id, frame&& f);
+			void read();
+			void flush();
+			void write_next();
+		};
+
+		struct rpc_client_lane final : rpc_lane
+		{
+			std::unordered_map<uint64_t, rpc_call_operation*> calls;
+
+			using rpc_lane::rpc_lane;
+
+			void connect(connection& conn);
+			void call(uint64_t id, rpc_call_operation& op);
+
+			void on_message(uint64_t id, rpc_message&& m) override;
+			void on_error(error_code ec) override;
+		};
+
+	} // namespace detail
+
+	/// answers one call. invoke it once with the response, now or later from
+	/// the connection's executor. a response to a stream that has since
+	/// failed is dropped
+	class rpc_reply
+	{
+		std::weak_ptr<detail::rpc_lane> lane;
+		uint64_t id;
+	public:
+		rpc_reply(std::weak_ptr<detail::rpc_lane> lane, uint64_t id)
+			: lane(std::move(lane)), id(id)
+		{
+		}
+
+		void operator()(std::vector<char> response) const
+		{
+			if (auto l = lane.lock(); l)
+			{
+				l->send(id, std::move(response));
+			}
+		}
+	};
+
+	/// issues calls over a few long-lived streams of one connection. the
+	/// streams are requested up front, so a call never waits on a stream to
+	/// open once they have, and calls are multiplexed onto the stream with
+	/// the fewest outstanding, tagged with an id the response is matched
+	/// by. a stream that fails is replaced on the next call while the
+	/// connection is open. the client isn't synchronized, and must be used
+	/// from the connection's executor and not outlive the connection
+	class rpc_client
+	{
+		connection& conn;
+		size_t max_message_size;
+		std::vector<std::shared_ptr<detail::rpc_client_lane>> lanes;
+		uint64_t next_id = 0;
+
+		std::shared_ptr<detail::rpc_client_lane> open_lane();
+		detail::rpc_client_lane* pick();
+		void call(detail::rpc_call_operation& op);
+	public:
+		/// open `streams` streams, but no more than the engine's
+		/// settings::max_streams_per_connection
+		explicit rpc_client(connection& conn, size_t streams = 4,
+			size_t max_message_size = message_stream::default_max_message_size);
+		/// outstanding calls fail with operation_canceled
+		~rpc_client();
+
+		rpc_client(const rpc_client&) = delete;
+		rpc_client& operator=(const rpc_client&) = delete;
+
+		using executor_type = connection::executor_type;
+		executor_type get_executor() const
+		{
+			return conn.get_executor();
+		}
+
+		size_t streams() const
+		{
+			return lanes.size();
+		}
+
+		/// send `request` and complete with the response. the request is
+		/// written straight from its buffer, which must stay valid until
+		/// completion
+		template<typename CompletionToken>
+		decltype(auto) async_call(boost::asio::const_buffer request, CompletionToken&& token)
+		{
+			return boost::asio::async_initiate<CompletionToken, void(error_code, rpc_message)>(
+				[this, request](auto h)
+				{
+					using Handler = std::decay_t<decltype(h)>;
+					using op_type = detail::rpc_call_async<Handler, executor_type>;
+					auto p = detail::handler_allocate<op_type>(h, std::move(h), get_executor(), request);
+					auto op = detail::handler_ptr<op_type, Handler>{ p, &p->handler };
+					call(*op);
+					op.release(); // release ownership
+				}, token);
+		}
+	};
+
+	namespace detail
+	{
+
+		template<typename Handler>
+		struct rpc_server_lane final : rpc_lane
+		{
+			std::shared_ptr<Handler> handler;
+
+			rpc_server_lane(std::unique_ptr<stream> s, std::shared_ptr<Handler> handler)
+				: rpc_lane(std::move(s), message_stream::default_max_message_size),
+				  handler(std::move(handler))
+			{
+			}
+
+			void on_message(uint64_t id, rpc_message&& m) override
+			{
+				(*handler)(std::move(m), rpc_reply{ weak_from_this(), id });
+			}
+
+			void on_error(error_code) override
+			{
+			}
+		};
+
+	} // namespace detail
+
+	/// answer rpc_client calls on the connection. the client's streams are
+	/// accepted with `depth` accepts kept outstanding, and every request is
+	/// passed to handler(rpc_message request, rpc_reply reply). serving
+	/// stops at the first accept error
+	template<typename Handler>
+	void serve_rpc(connection& conn, size_t depth, Handler&& handler)
+	{
+		using handler_type = std::decay_t<Handler>;
+		auto h = std::make_shared<handler_type>(std::forward<Handler>(handler));
+		accept_loop(conn, depth, [h](error_code ec, std::unique_ptr<stream> s)
+		{
+			if (ec)
+			{
+				return;
+			}
+			auto lane = std::make_shared<detail::rpc_server_lane<handler_type>>(std::move(s), h);
+			lane->start();
+		});
+	}
+
+} // namespace quic
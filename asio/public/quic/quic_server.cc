@@ -21,6 +21,11 @@ namespace quic
 		return engine.get_executor();
 	}
 
+	memory_stats server::memory_stats() const
+	{
+		return engine.memory_stats();
+	}
+
 	void server::close()
 	{
 		engine.close();
@@ -26,6 +26,9 @@ namespace quic
 
 		executor_type get_executor() const;
 
+		/// memory charged against settings::memory_budget
+		quic::memory_stats memory_stats() const;
+
 		void close();
 	};
 
@@ -17,6 +17,10 @@ namespace quic
 			out.connection_flow_control_window = in.es_init_max_data;
 			out.incoming_stream_flow_control_window = in.es_init_max_stream_data_bidi_remote;
 			out.outgoing_stream_flow_control_window = in.es_init_max_stream_data_bidi_local;
+			out.max_connection_flow_control_window = in.es_max_cfcw;
+			out.max_stream_flow_control_window = in.es_max_sfcw;
+			out.datagrams = in.es_datagrams;
+			out.memory_budget = 0; // not an lsquic setting
 		}
 
 		void write_settings(const settings& in, lsquic_engine_settings& out)
@@ -27,6 +31,9 @@ namespace quic
 			out.es_init_max_data = in.connection_flow_control_window;
 			out.es_init_max_stream_data_bidi_remote = in.incoming_stream_flow_control_window;
 			out.es_init_max_stream_data_bidi_local = in.outgoing_stream_flow_control_window;
+			out.es_max_cfcw = in.max_connection_flow_control_window;
+			out.es_max_sfcw = in.max_stream_flow_control_window;
+			out.es_datagrams = in.datagrams;
 		}
 
 		bool check_settings(const lsquic_engine_settings& es, int flags, std::string* message)
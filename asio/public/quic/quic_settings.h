@@ -26,6 +26,43 @@ namespace quic
 		uint32_t incoming_stream_flow_control_window;
 
 		uint32_t outgoing_stream_flow_control_window;
+
+		/// flow control auto-tuning. the windows above are where every
+		/// connection and stream starts, so keep them small enough to hold
+		/// for every connection at once. when a peer uses up a window within
+		/// a couple of round trips, lsquic doubles it, up to these maximums;
+		/// connections that don't fill their windows never grow them. size the
+		/// maximums for the bandwidth-delay product of the longest link, or
+		/// set 0 to keep windows at their initial size. memory_budget charges
+		/// every connection the maximum, whether or not it grows that far
+		uint32_t max_connection_flow_control_window;
+
+		/// applies to incoming streams
+		uint32_t max_stream_flow_control_window;
+
+		/// enable the DATAGRAM extension (RFC 9221). both peers have to
+		bool datagrams;
+
+		/// bytes the engine may hold for all of its connections, or 0 for no
+		/// limit. each connection is charged the larger of its
+		/// connection_flow_control_window and max_connection_flow_control_window,
+		/// which bounds what lsquic buffers for it, and read-ahead buffers and
+		/// queued datagrams are charged as they're allocated. windows already
+		/// advertised are never shrunk under pressure, since lsquic sizes them
+		/// for the whole engine. instead the engine stops taking on more: past
+		/// 7/8 of the budget, new incoming connections and streams are
+		/// refused. read-ahead that doesn't fit fails with no_buffer_space, as
+		/// does a datagram send, and incoming datagrams are dropped. outgoing
+		/// connections are always charged but never refused
+		size_t memory_budget;
+	};
+
+	/// an engine's memory budget and how much of it is in use
+	struct memory_stats
+	{
+		size_t budget; // 0 for unlimited
+		size_t used;
+		bool pressure; // new connections and streams are being refused
 	};
 
 	settings default_client_settings();
@@ -92,7 +92,10 @@ namespace quic
 
 		void socket_impl::on_connect(connection_impl& c, lsquic_conn_t* conn)
 		{
-			connection_state::on_connect(c._state, conn);
+			// outgoing connections are charged, but left to the application to limit
+			auto charge = memory_charge{ engine.budget };
+			charge.grow(engine.connection_window);
+			connection_state::on_connect(c._state, conn, std::move(charge));
 			open_connections.push_back(c);
 		}
 
@@ -119,6 +122,13 @@ namespace quic
 		connection_context* socket_impl::on_accept(lsquic_conn_t* conn)
 		{
 			assert(conn);
+			// refuse connections the memory budget can't take on
+			auto charge = memory_charge{ engine.budget };
+			if (engine.budget.pressure() || !charge.try_grow(engine.connection_window))
+			{
+				::lsquic_conn_close(conn);
+				return nullptr;
+			}
 			if (accepting_connections.empty())
 			{
 				if (incoming_connections.full())
@@ -126,13 +136,13 @@ namespace quic
 					::lsquic_conn_close(conn);
 					return nullptr;
 				}
-				incoming_connections.push_back({ conn, engine.max_streams_per_connection });
+				incoming_connections.push_back({ conn, engine.max_streams_per_connection, std::move(charge) });
 				return &incoming_connections.back();
 			}
 			auto& c = accepting_connections.front();
 			list_transfer(c, accepting_connections, open_connections);
 
-			connection_state::on_accept(c._state, conn);
+			connection_state::on_accept(c._state, conn, std::move(charge));
 			return &c;
 		}
 
@@ -46,6 +46,126 @@ namespace quic
 		return sid;
 	}
 
+	void stream::set_priority(unsigned priority, error_code& ec)
+	{
+		impl.set_priority(priority, ec);
+	}
+
+	void stream::set_priority(unsigned priority)
+	{
+		error_code ec;
+		set_priority(priority, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	unsigned stream::priority(error_code& ec) const
+	{
+		return impl.priority(ec);
+	}
+
+	unsigned stream::priority() const
+	{
+		error_code ec;
+		auto prio = priority(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return prio;
+	}
+
+	void stream::set_read_ahead(size_t bytes, error_code& ec)
+	{
+		impl.set_read_ahead(bytes, ec);
+	}
+
+	void stream::set_read_ahead(size_t bytes)
+	{
+		error_code ec;
+		set_read_ahead(bytes, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	size_t stream::send_file(int fd, off_t offset, size_t length, error_code& ec)
+	{
+		return impl.send_file(fd, offset, length, ec);
+	}
+
+	size_t stream::send_file(int fd, off_t offset, size_t length)
+	{
+		error_code ec;
+		const size_t bytes = send_file(fd, offset, length, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+		return bytes;
+	}
+
+	void stream::cork(error_code& ec)
+	{
+		impl.cork(ec);
+	}
+
+	void stream::cork()
+	{
+		error_code ec;
+		cork(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	void stream::uncork(error_code& ec)
+	{
+		impl.uncork(ec);
+	}
+
+	void stream::uncork()
+	{
+		error_code ec;
+		uncork(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	void stream::wait(wait_type w, error_code& ec)
+	{
+		auto op = detail::stream_wait_sync{};
+		impl.wait(w, op);
+		op.wait();
+		ec = std::get<0>(*op.result);
+	}
+
+	void stream::wait(wait_type w)
+	{
+		error_code ec;
+		wait(w, ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+	void stream::non_blocking(bool mode)
+	{
+		impl.nonblocking = mode;
+	}
+
+	bool stream::non_blocking() const
+	{
+		return impl.nonblocking;
+	}
+
 	void stream::flush(error_code& ec)
 	{
 		impl.flush(ec);
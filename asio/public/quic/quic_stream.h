@@ -1,7 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include "../asio_error_code.h"
 #include "quic_stream_id.h"
+#include "detail/awaitable.h"
 #include "detail/stream_impl.h"
 
 namespace quic
@@ -18,11 +20,13 @@ namespace quic
 	} // namespace detail
 
 	class connection;
+	class wheel_timer;
 
 	class stream
 	{
 	protected:
 		friend class connection;
+		friend class wheel_timer;
 		friend class detail::connection_impl;
 		detail::stream_impl impl;
 		explicit stream(detail::connection_impl& impl);
@@ -45,10 +49,30 @@ namespace quic
 		stream_id id(error_code& ec) const;
 		stream_id id() const;
 
+		/// lsquic always sends from the highest priority stream that has data,
+		/// and round-robins between streams of equal priority. valid values are
+		/// 1 (highest) through 256 (lowest). h3 streams that use extensible
+		/// priorities are scheduled by h3::stream::set_http_priority() instead
+		void set_priority(unsigned priority, error_code& ec);
+		void set_priority(unsigned priority);
+
+		unsigned priority(error_code& ec) const;
+		unsigned priority() const;
+
 		template<typename MutableBufferSequence, typename CompletionToken>
 		decltype(auto) async_read_some(const MutableBufferSequence& buffers, CompletionToken&& token)
 		{
-			return impl.async_read_some(buffers, std::forward<CompletionToken>(token));
+			return impl.async_read_some(impl.get_executor(), buffers, std::forward<CompletionToken>(token));
+		}
+
+		/// fails with errc::timed_out if nothing was read by the deadline. the
+		/// stream stays open and can be read again. deadlines are kept by the
+		/// engine with millisecond resolution and cost no timer of their own
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read_some(const MutableBufferSequence& buffers,
+			std::chrono::steady_clock::time_point deadline, CompletionToken&& token)
+		{
+			return impl.async_read_some(impl.get_executor(), buffers, deadline, std::forward<CompletionToken>(token));
 		}
 
 		template<typename MutableBufferSequence>
@@ -69,10 +93,92 @@ namespace quic
 			return bytes;
 		}
 
+		/// read until the buffers are full, or until at least `minimum` bytes
+		/// have arrived when that's nonzero. one operation is kept across all
+		/// the partial reads in lsquic's callbacks and completes once. the end
+		/// of the stream before then fails with stream_error::eof, along with
+		/// the bytes that were read. as with async_write_all(), more than 128
+		/// buffers fail with errc::invalid_argument unless the extra ones are
+		/// empty
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read(const MutableBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_read(impl.get_executor(), buffers, 0, std::forward<CompletionToken>(token));
+		}
+
+		template<typename MutableBufferSequence, typename CompletionToken>
+		decltype(auto) async_read(const MutableBufferSequence& buffers, size_t minimum, CompletionToken&& token)
+		{
+			return impl.async_read(impl.get_executor(), buffers, minimum, std::forward<CompletionToken>(token));
+		}
+
+		template<typename MutableBufferSequence>
+		size_t read(const MutableBufferSequence& buffers, size_t minimum, error_code& ec)
+		{
+			return impl.read(buffers, minimum, ec);
+		}
+
+		template<typename MutableBufferSequence>
+		size_t read(const MutableBufferSequence& buffers, error_code& ec)
+		{
+			return impl.read(buffers, 0, ec);
+		}
+
+		template<typename MutableBufferSequence>
+		size_t read(const MutableBufferSequence& buffers, size_t minimum = 0)
+		{
+			error_code ec;
+			const size_t bytes = impl.read(buffers, minimum, ec);
+			if (ec)
+			{
+				throw system_error(ec);
+			}
+			return bytes;
+		}
+
+		/// buffer up to `bytes` of incoming data ahead of reads. lsquic is drained
+		/// into the buffer until it's full, and read_some() is served from memory
+		/// while it has data. 0 disables read-ahead once the buffer is empty.
+		/// fails with no_buffer_space if the engine's memory budget can't
+		/// cover the buffer
+		void set_read_ahead(size_t bytes, error_code& ec);
+		void set_read_ahead(size_t bytes);
+
+		using wait_type = boost::asio::socket_base::wait_type;
+		static constexpr wait_type wait_read = boost::asio::socket_base::wait_read;
+		static constexpr wait_type wait_write = boost::asio::socket_base::wait_write;
+
+		/// wait until the stream is readable or writable, without tying up a
+		/// buffer. pair with non-blocking read_some() and write_some(). other
+		/// wait types fail with operation_not_supported
+		template<typename CompletionToken>
+		decltype(auto) async_wait(wait_type w, CompletionToken&& token)
+		{
+			return impl.async_wait(impl.get_executor(), w, std::forward<CompletionToken>(token));
+		}
+
+		void wait(wait_type w, error_code& ec);
+		void wait(wait_type w);
+
+		/// in non-blocking mode, synchronous read_some() and write_some() fail
+		/// with would_block instead of waiting. asynchronous operations are
+		/// unaffected
+		void non_blocking(bool mode);
+		bool non_blocking() const;
+
 		template<typename ConstBufferSequence, typename CompletionToken>
 		decltype(auto) async_write_some(const ConstBufferSequence& buffers, CompletionToken&& token)
 		{
-			return impl.async_write_some(buffers, std::forward<CompletionToken>(token));
+			return impl.async_write_some(impl.get_executor(), buffers, std::forward<CompletionToken>(token));
+		}
+
+		/// fails with errc::timed_out if flow control kept anything from being
+		/// written by the deadline
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_some(const ConstBufferSequence& buffers,
+			std::chrono::steady_clock::time_point deadline, CompletionToken&& token)
+		{
+			return impl.async_write_some(impl.get_executor(), buffers, deadline, std::forward<CompletionToken>(token));
 		}
 
 		template<typename ConstBufferSequence>
@@ -92,6 +198,59 @@ namespace quic
 			return bytes;
 		}
 
+		/// write the entire buffer sequence and complete once. lsquic pulls the
+		/// bytes straight from these buffers into outgoing packets with
+		/// lsquic_stream_writef(), so they must stay valid until completion.
+		/// a sequence of more than 128 buffers fails with
+		/// errc::invalid_argument, unless the extra ones are empty
+		template<typename ConstBufferSequence, typename CompletionToken>
+		decltype(auto) async_write_all(const ConstBufferSequence& buffers, CompletionToken&& token)
+		{
+			return impl.async_write_all(impl.get_executor(), buffers, std::forward<CompletionToken>(token));
+		}
+
+		template<typename ConstBufferSequence>
+		size_t write_all(const ConstBufferSequence& buffers, error_code& ec)
+		{
+			return impl.write_all(buffers, ec);
+		}
+		template<typename ConstBufferSequence>
+		size_t write_all(const ConstBufferSequence& buffers)
+		{
+			error_code ec;
+			const size_t bytes = impl.write_all(buffers, ec);
+			if (ec)
+			{
+				throw system_error(ec);
+			}
+			return bytes;
+		}
+
+		/// send `length` bytes of the file starting at `offset`. the range is
+		/// memory-mapped and lsquic reads it straight from the page cache, with
+		/// a single completion once all of it has been consumed. fails with
+		/// invalid_argument if the range runs past the end of the file. the
+		/// file must not be truncated while it's being sent
+		template<typename CompletionToken>
+		decltype(auto) async_send_file(int fd, off_t offset, size_t length, CompletionToken&& token)
+		{
+			return impl.async_send_file(impl.get_executor(), fd, offset, length, std::forward<CompletionToken>(token));
+		}
+
+		size_t send_file(int fd, off_t offset, size_t length, error_code& ec);
+		size_t send_file(int fd, off_t offset, size_t length);
+
+		/// while corked, write_some() copies into a per-stream gather buffer and
+		/// completes at once. the gathered bytes go to lsquic as one write plus a
+		/// flush on uncork(), or when 64 KiB have piled up; until those have
+		/// gone out, further writes wait like uncorked ones. shutdown(1) and
+		/// close() send the FIN only after every gathered byte is written
+		void cork(error_code& ec);
+		void cork();
+
+		void uncork(error_code& ec);
+		void uncork();
+
 		void flush(error_code& ec);
 		void flush();
 
@@ -101,13 +260,110 @@ namespace quic
 		template<typename CompletionToken>
 		decltype(auto) async_close(CompletionToken&& token)
 		{
-			return impl.async_close(std::forward<CompletionToken>(token));
+			return impl.async_close(impl.get_executor(), std::forward<CompletionToken>(token));
 		}
 
 		void close(error_code& ec);
 		void close();
 
 		void reset();
+
+		/// awaitable versions of async_read_some(), async_read(),
+		/// async_write_some(), async_write_all() and async_close() for C++20
+		/// coroutines. the operation lives in the coroutine frame instead of a
+		/// handler allocation, and the coroutine is resumed on the stream's
+		/// executor. co_await throws system_error on failure, unless given an
+		/// error_code
+		template<typename MutableBufferSequence>
+		auto co_read_some(const MutableBufferSequence& buffers, error_code* ec = nullptr)
+		{
+			return data_awaiter{ impl, &detail::stream_impl::read_some, ec,
+								 [&buffers](detail::stream_data_operation& op)
+								 { detail::stream_impl::init_op(buffers, op); } };
+		}
+
+		template<typename MutableBufferSequence>
+		auto co_read_some(const MutableBufferSequence& buffers, error_code& ec)
+		{
+			return co_read_some(buffers, &ec);
+		}
+
+		template<typename MutableBufferSequence>
+		auto co_read(const MutableBufferSequence& buffers, error_code* ec = nullptr)
+		{
+			return data_awaiter{ impl, &detail::stream_impl::read_all, ec,
+								 [&buffers](detail::stream_data_operation& op)
+								 { detail::stream_impl::init_op(buffers, op); } };
+		}
+
+		template<typename MutableBufferSequence>
+		auto co_read(const MutableBufferSequence& buffers, error_code& ec)
+		{
+			return co_read(buffers, &ec);
+		}
+
+		template<typename ConstBufferSequence>
+		auto co_write_some(const ConstBufferSequence& buffers, error_code* ec = nullptr)
+		{
+			return data_awaiter{ impl, &detail::stream_impl::write_some, ec,
+								 [&buffers](detail::stream_data_operation& op)
+								 { detail::stream_impl::init_op(buffers, op); } };
+		}
+
+		template<typename ConstBufferSequence>
+		auto co_write_some(const ConstBufferSequence& buffers, error_code& ec)
+		{
+			return co_write_some(buffers, &ec);
+		}
+
+		template<typename ConstBufferSequence>
+		auto co_write_all(const ConstBufferSequence& buffers, error_code* ec = nullptr)
+		{
+			return data_awaiter{ impl, &detail::stream_impl::write_all, ec,
+								 [&buffers](detail::stream_data_operation& op)
+								 { detail::stream_impl::init_op(buffers, op); } };
+		}
+
+		template<typename ConstBufferSequence>
+		auto co_write_all(const ConstBufferSequence& buffers, error_code& ec)
+		{
+			return co_write_all(buffers, &ec);
+		}
+
+		auto co_close(error_code* ec = nullptr)
+		{
+			return close_awaiter{ impl, &detail::stream_impl::close, ec, detail::no_prepare{} };
+		}
+
+		auto co_close(error_code& ec)
+		{
+			return co_close(&ec);
+		}
+
+	private:
+		using data_awaiter = detail::operation_awaiter<detail::stream_impl, detail::stream_data_operation>;
+		using close_awaiter = detail::operation_awaiter<detail::stream_impl, detail::stream_close_operation>;
+	};
+
+	/// corks a stream for the lifetime of the guard
+	class cork_guard
+	{
+		stream& s;
+
+	public:
+		explicit cork_guard(stream& s) : s(s)
+		{
+			s.cork();
+		}
+
+		~cork_guard()
+		{
+			error_code ec;
+			s.uncork(ec);
+		}
+
+		cork_guard(const cork_guard&) = delete;
+		cork_guard& operator=(const cork_guard&) = delete;
 	};
 
 } // namespace quic
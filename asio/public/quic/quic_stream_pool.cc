@@ -0,0 +1,39 @@
+#include "quic_stream_pool.h"
+#include "quic_connection.h"
+#include "quic_stream.h"
+
+namespace quic
+{
+
+	stream_pool::stream_pool(connection& conn, size_t max_idle)
+		: conn(conn), max_idle(max_idle)
+	{
+	}
+
+	stream_pool::~stream_pool() = default;
+
+	std::unique_ptr<stream> stream_pool::acquire()
+	{
+		if (idle.empty())
+		{
+			return std::make_unique<stream>(conn);
+		}
+		auto s = std::move(idle.back());
+		idle.pop_back();
+		return s;
+	}
+
+	void stream_pool::release(std::unique_ptr<stream> s)
+	{
+		if (!s)
+		{
+			return;
+		}
+		s->reset();
+		if (idle.size() < max_idle)
+		{
+			idle.push_back(std::move(s));
+		}
+	}
+
+} // namespace quic
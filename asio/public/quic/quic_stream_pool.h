@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace quic
+{
+
+	class connection;
+	class stream;
+
+	/// recycles the streams of one connection. acquire() hands back a
+	/// released stream when there is one, so steady-state churn reuses its
+	/// allocation and service registration instead of making new ones. the
+	/// pool isn't synchronized, and must not outlive its connection
+	class stream_pool
+	{
+		connection& conn;
+		std::vector<std::unique_ptr<stream>> idle;
+		size_t max_idle;
+	public:
+		explicit stream_pool(connection& conn, size_t max_idle = 64);
+		~stream_pool();
+
+		stream_pool(const stream_pool&) = delete;
+		stream_pool& operator=(const stream_pool&) = delete;
+
+		/// a closed stream, ready to connect or accept
+		std::unique_ptr<stream> acquire();
+
+		/// return a stream to the pool. one that's still open is reset first,
+		/// as its destructor would. beyond max_idle it's simply destroyed
+		void release(std::unique_ptr<stream> s);
+
+		size_t size() const
+		{
+			return idle.size();
+		}
+	};
+
+} // namespace quic
@@ -0,0 +1,61 @@
+#include "quic_wheel_timer.h"
+#include "quic_connection.h"
+#include "quic_stream.h"
+#include "detail/socket_impl.h"
+
+namespace quic
+{
+
+	wheel_timer::wheel_timer(connection& conn)
+		: impl(conn.impl._socket.engine)
+	{
+	}
+
+	wheel_timer::wheel_timer(stream& s)
+		: impl(s.impl.engine)
+	{
+	}
+
+	wheel_timer::~wheel_timer() = default;
+
+	wheel_timer::executor_type wheel_timer::get_executor() const
+	{
+		return impl.get_executor();
+	}
+
+	wheel_timer::time_point wheel_timer::expiry() const
+	{
+		return impl.expiry();
+	}
+
+	size_t wheel_timer::expires_at(time_point t)
+	{
+		return impl.expires_at(t);
+	}
+
+	size_t wheel_timer::expires_after(duration d)
+	{
+		return impl.expires_at(clock_type::now() + d);
+	}
+
+	size_t wheel_timer::cancel()
+	{
+		return impl.cancel();
+	}
+
+	void wheel_timer::wait(error_code& ec)
+	{
+		impl.wait(ec);
+	}
+
+	void wheel_timer::wait()
+	{
+		error_code ec;
+		wait(ec);
+		if (ec)
+		{
+			throw system_error(ec);
+		}
+	}
+
+} // namespace quic
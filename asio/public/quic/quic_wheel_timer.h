@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include "../asio_error_code.h"
+#include "detail/timer_impl.h"
+
+namespace quic
+{
+
+	class connection;
+	class stream;
+
+	/// a timer for application timeouts, like idle or per-request limits.
+	/// it waits on the timer wheel of the engine that runs the given
+	/// connection or stream, so scheduling and cancellation are O(1) and many
+	/// thousands of timers share the engine's single steady_timer. expiries
+	/// have millisecond resolution. the interface follows steady_timer, but
+	/// only one wait may be pending at a time. the timer must not outlive the
+	/// client or server of its connection
+	class wheel_timer
+	{
+		detail::timer_impl impl;
+	public:
+		using executor_type = detail::timer_impl::executor_type;
+		using clock_type = std::chrono::steady_clock;
+		using duration = clock_type::duration;
+		using time_point = clock_type::time_point;
+
+		explicit wheel_timer(connection& conn);
+		explicit wheel_timer(stream& s);
+		~wheel_timer();
+
+		wheel_timer(const wheel_timer&) = delete;
+		wheel_timer& operator=(const wheel_timer&) = delete;
+
+		executor_type get_executor() const;
+
+		time_point expiry() const;
+
+		/// a pending wait completes with operation_canceled. returns the
+		/// number of waits canceled
+		size_t expires_at(time_point t);
+		size_t expires_after(duration d);
+		size_t cancel();
+
+		template<typename CompletionToken>
+		decltype(auto) async_wait(CompletionToken&& token)
+		{
+			return impl.async_wait(std::forward<CompletionToken>(token));
+		}
+
+		void wait(error_code& ec);
+		void wait();
+	};
+
+} // namespace quic
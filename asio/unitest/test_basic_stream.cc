@@ -0,0 +1,76 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <boost/asio/strand.hpp>
+#include "quic/quic_basic_stream.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class BasicStream : public test::client_server
+	{
+	};
+
+	using io_stream = quic::basic_stream<boost::asio::io_context::executor_type>;
+
+	TEST_F(BasicStream, executor_type_mismatch)
+	{
+		using strand_stream = quic::basic_stream<boost::asio::strand<boost::asio::io_context::executor_type>>;
+		EXPECT_THROW(strand_stream{ cconn }, system_error);
+	}
+
+	TEST_F(BasicStream, write_read)
+	{
+		static constexpr std::string_view message = "typed";
+
+		auto client_stream = io_stream{ cconn };
+		EXPECT_EQ(context.get_executor(), client_stream.get_executor());
+		std::optional<error_code> connect_ec;
+		cconn.async_connect(client_stream, capture(connect_ec));
+		run_until(context, [&]
+		{ return connect_ec.has_value(); });
+		ASSERT_TRUE(connect_ec);
+		ASSERT_EQ(ok, *connect_ec);
+
+		std::optional<error_code> write_ec;
+		client_stream.async_write_all(boost::asio::buffer(message), capture(write_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		ASSERT_EQ(ok, *write_ec);
+		client_stream.shutdown(1);
+
+		auto server_stream = io_stream{ sconn };
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(server_stream, capture(accept_ec));
+		run_until(context, [&]
+		{ return accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		ASSERT_EQ(ok, *accept_ec);
+
+		auto data = std::array<char, 5>{};
+		std::optional<error_code> read_ec;
+		server_stream.async_read(boost::asio::buffer(data), capture(read_ec));
+		run_until(context, [&]
+		{ return read_ec.has_value(); });
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		EXPECT_EQ(message, std::string_view(data.data(), data.size()));
+	}
+
+} // namespace nexus
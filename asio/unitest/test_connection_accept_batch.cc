@@ -0,0 +1,234 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "quic/quic_accept_loop.h"
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	// streams are opened one by one rather than with the fixture's cstream
+	// and sstream, which stay unused
+	class AcceptBatch : public test::client_server
+	{
+	protected:
+		std::array<quic::stream, 4> sstreams{ quic::stream{ sconn }, quic::stream{ sconn },
+											  quic::stream{ sconn }, quic::stream{ sconn } };
+		std::array<quic::stream, 3> cstreams{ quic::stream{ cconn }, quic::stream{ cconn }, quic::stream{ cconn } };
+
+		void SetUp() override
+		{
+			acceptor.listen(16);
+
+			std::optional<error_code> accept_ec;
+			acceptor.async_accept(sconn, capture(accept_ec));
+
+			// the connection is only accepted once it carries a stream
+			open_client_stream(cstreams[0]);
+			run_until(context, [&]
+			{ return accept_ec.has_value(); });
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+		}
+
+		// the server sees a stream once data arrives on it
+		void open_client_stream(quic::stream& s)
+		{
+			std::optional<error_code> connect_ec;
+			cconn.async_connect(s, capture(connect_ec));
+			run_until(context, [&]
+			{ return connect_ec.has_value(); });
+			ASSERT_TRUE(connect_ec);
+			ASSERT_EQ(ok, *connect_ec);
+
+			std::optional<error_code> write_ec;
+			s.async_write_some(boost::asio::buffer("a", 1), capture(write_ec));
+			run_until(context, [&]
+			{ return write_ec.has_value(); });
+			ASSERT_TRUE(write_ec);
+			ASSERT_EQ(ok, *write_ec);
+			s.flush();
+		}
+	};
+
+	TEST_F(AcceptBatch, not_connected)
+	{
+		auto conn = quic::connection{ acceptor };
+		auto streams = std::array<quic::stream, 1>{ quic::stream{ conn } };
+		std::optional<error_code> accept_ec;
+		size_t count = 1;
+		conn.async_accept_some(streams, capture(accept_ec, count));
+		context.poll();
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(errc::bad_file_descriptor, *accept_ec);
+		EXPECT_EQ(0, count);
+	}
+
+	TEST_F(AcceptBatch, queued)
+	{
+		open_client_stream(cstreams[1]);
+		open_client_stream(cstreams[2]);
+		context.poll();
+
+		// loopback may deliver the streams over several engine passes, so
+		// keep accepting into the rest of the array
+		size_t accepted = 0;
+		for (int i = 0; i < 3 && accepted < cstreams.size(); i++)
+		{
+			auto rest = std::span<quic::stream>{ sstreams }.subspan(accepted);
+			std::optional<error_code> accept_ec;
+			size_t count = 0;
+			sconn.async_accept_some(rest, capture(accept_ec, count));
+			run_until(context, [&]
+			{ return accept_ec.has_value(); });
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+			accepted += count;
+		}
+		ASSERT_EQ(cstreams.size(), accepted);
+		for (size_t i = 0; i < accepted; i++)
+		{
+			EXPECT_TRUE(sstreams[i].is_open());
+		}
+		EXPECT_FALSE(sstreams[3].is_open());
+	}
+
+	TEST_F(AcceptBatch, waiting)
+	{
+		// take the stream from SetUp() out of the way first
+		ASSERT_EQ(1, sconn.accept_some(std::span<quic::stream>{ sstreams }.first(1)));
+
+		auto rest = std::span<quic::stream>{ sstreams }.subspan(1);
+		std::optional<error_code> accept_ec;
+		size_t count = 0;
+		sconn.async_accept_some(rest, capture(accept_ec, count));
+		context.poll();
+		ASSERT_FALSE(accept_ec); // nothing queued yet
+
+		open_client_stream(cstreams[1]);
+		run_until(context, [&]
+		{ return accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+		ASSERT_EQ(1, count);
+		EXPECT_TRUE(sstreams[1].is_open());
+
+		// the members that weren't needed are closed again and reusable
+		EXPECT_FALSE(sstreams[2].is_open());
+		open_client_stream(cstreams[2]);
+		std::optional<error_code> again_ec;
+		sconn.async_accept_some(std::span<quic::stream>{ sstreams }.subspan(2), capture(again_ec, count));
+		run_until(context, [&]
+		{ return again_ec.has_value(); });
+		ASSERT_TRUE(again_ec);
+		EXPECT_EQ(ok, *again_ec);
+		EXPECT_EQ(1, count);
+		EXPECT_TRUE(sstreams[2].is_open());
+	}
+
+	TEST_F(AcceptBatch, member_destroyed)
+	{
+		ASSERT_EQ(1, sconn.accept_some(std::span<quic::stream>{ sstreams }.first(1)));
+
+		std::optional<error_code> accept_ec;
+		size_t count = 0;
+		{
+			auto members = std::array<quic::stream, 2>{ quic::stream{ sconn }, quic::stream{ sconn } };
+			sconn.async_accept_some(members, capture(accept_ec, count));
+			context.poll();
+			ASSERT_FALSE(accept_ec);
+		}
+		// with every member gone, the batch completes without touching them
+		context.poll();
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(quic::stream_error::aborted, *accept_ec);
+		EXPECT_EQ(0, count);
+
+		// a stream that arrives later is queued for the next accept
+		open_client_stream(cstreams[1]);
+		std::optional<error_code> again_ec;
+		sconn.async_accept_some(std::span<quic::stream>{ sstreams }.subspan(1), capture(again_ec, count));
+		run_until(context, [&]
+		{ return again_ec.has_value(); });
+		ASSERT_TRUE(again_ec);
+		EXPECT_EQ(ok, *again_ec);
+		EXPECT_EQ(1, count);
+	}
+
+	TEST_F(AcceptBatch, already_pending)
+	{
+		ASSERT_EQ(1, sconn.accept_some(std::span<quic::stream>{ sstreams }.first(1)));
+
+		std::optional<error_code> accept_ec;
+		sconn.async_accept_some(std::span<quic::stream>{ sstreams }.subspan(1, 2), capture(accept_ec));
+		std::optional<error_code> second_ec;
+		sconn.async_accept_some(std::span<quic::stream>{ sstreams }.subspan(3), capture(second_ec));
+		context.poll();
+		ASSERT_TRUE(second_ec);
+		EXPECT_EQ(errc::invalid_argument, *second_ec);
+		EXPECT_FALSE(accept_ec);
+	}
+
+	TEST_F(AcceptBatch, close_cancels_accept)
+	{
+		ASSERT_EQ(1, sconn.accept_some(std::span<quic::stream>{ sstreams }.first(1)));
+
+		std::optional<error_code> accept_ec;
+		size_t count = 1;
+		sconn.async_accept_some(std::span<quic::stream>{ sstreams }.subspan(1), capture(accept_ec, count));
+		sconn.close();
+		context.poll();
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(quic::connection_error::aborted, *accept_ec);
+		EXPECT_EQ(0, count);
+	}
+
+	TEST_F(AcceptBatch, accept_loop)
+	{
+		auto accepted = std::vector<std::unique_ptr<quic::stream>>{};
+		std::optional<error_code> loop_ec;
+		quic::accept_loop(sconn, 2,
+			[&](error_code ec, std::unique_ptr<quic::stream> s)
+			{
+				if (ec)
+				{
+					loop_ec = ec;
+					return;
+				}
+				accepted.push_back(std::move(s));
+			});
+
+		open_client_stream(cstreams[1]);
+		open_client_stream(cstreams[2]);
+		run_until(context, [&]
+		{ return accepted.size() == cstreams.size(); });
+		ASSERT_EQ(cstreams.size(), accepted.size());
+		for (auto& s : accepted)
+		{
+			EXPECT_TRUE(s->is_open());
+		}
+		EXPECT_FALSE(loop_ec);
+
+		sconn.close();
+		context.poll();
+		ASSERT_TRUE(loop_ec);
+		EXPECT_EQ(quic::connection_error::aborted, *loop_ec);
+	}
+
+} // namespace nexus
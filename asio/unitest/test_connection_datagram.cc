@@ -0,0 +1,142 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+		quic::settings datagram_settings()
+		{
+			auto settings = quic::default_server_settings();
+			settings.datagrams = true;
+			return settings;
+		}
+
+	} // anonymous namespace
+
+	class Datagram : public test::client_server
+	{
+	protected:
+		Datagram()
+			: client_server(datagram_settings(), datagram_settings())
+		{
+		}
+
+		void send(std::string_view message)
+		{
+			std::optional<error_code> send_ec;
+			cconn.async_send_datagram(boost::asio::buffer(message), capture(send_ec));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(send_ec);
+			EXPECT_EQ(ok, *send_ec);
+		}
+	};
+
+	TEST_F(Datagram, not_connected)
+	{
+		auto conn = quic::connection{ client };
+		std::optional<error_code> send_ec;
+		conn.async_send_datagram(boost::asio::buffer("x", 1), capture(send_ec));
+		context.poll();
+		ASSERT_TRUE(send_ec);
+		EXPECT_EQ(errc::not_connected, *send_ec);
+	}
+
+	TEST_F(Datagram, send_receive)
+	{
+		auto data = std::array<char, 64>{};
+		std::optional<error_code> receive_ec;
+		size_t bytes = 0;
+		sconn.async_receive_datagram(boost::asio::buffer(data), capture(receive_ec, bytes));
+
+		send("ping");
+
+		run_until(context, [&]
+		{ return receive_ec.has_value(); });
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(ok, *receive_ec);
+		EXPECT_EQ("ping", std::string_view(data.data(), bytes));
+		EXPECT_EQ(1, cconn.datagram_stats().sent);
+		EXPECT_EQ(1, sconn.datagram_stats().received);
+	}
+
+	TEST_F(Datagram, truncated)
+	{
+		send("hello world");
+		run_until(context, [&]
+		{ return sconn.datagram_stats().received == 1; });
+
+		auto data = std::array<char, 5>{};
+		std::optional<error_code> receive_ec;
+		size_t bytes = 0;
+		sconn.async_receive_datagram(boost::asio::buffer(data), capture(receive_ec, bytes));
+		context.poll();
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(errc::message_size, *receive_ec);
+		EXPECT_EQ("hello", std::string_view(data.data(), bytes));
+	}
+
+	TEST_F(Datagram, receive_queue_drops_oldest)
+	{
+		sconn.set_datagram_queue_size(2);
+		send("1");
+		send("2");
+		send("3");
+		run_until(context, [&]
+		{ return sconn.datagram_stats().received == 3; });
+		EXPECT_EQ(1, sconn.datagram_stats().dropped_incoming);
+
+		auto received = std::string{};
+		for (int i = 0; i < 2; i++)
+		{
+			auto data = std::array<char, 8>{};
+			std::optional<error_code> receive_ec;
+			size_t bytes = 0;
+			sconn.async_receive_datagram(boost::asio::buffer(data), capture(receive_ec, bytes));
+			context.poll();
+			ASSERT_TRUE(receive_ec);
+			EXPECT_EQ(ok, *receive_ec);
+			received.append(data.data(), bytes);
+		}
+		EXPECT_EQ(2, received.size());
+		EXPECT_EQ(std::string::npos, received.find('1'));
+	}
+
+	TEST_F(Datagram, oversized)
+	{
+		auto data = std::vector<char>(65536);
+		std::optional<error_code> send_ec;
+		cconn.async_send_datagram(boost::asio::buffer(data), capture(send_ec));
+		context.poll();
+		ASSERT_TRUE(send_ec);
+		EXPECT_EQ(errc::message_size, *send_ec);
+		EXPECT_EQ(1, cconn.datagram_stats().oversized);
+	}
+
+	TEST_F(Datagram, close_cancels_receive)
+	{
+		auto data = std::array<char, 8>{};
+		std::optional<error_code> receive_ec;
+		sconn.async_receive_datagram(boost::asio::buffer(data), capture(receive_ec));
+		sconn.close();
+		context.poll();
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(quic::connection_error::aborted, *receive_ec);
+	}
+
+} // namespace nexus
@@ -0,0 +1,87 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class ConnectionMemory : public test::client_server
+	{
+	};
+
+	TEST_F(ConnectionMemory, idle_connection_holds_no_heap)
+	{
+		auto unconnected = quic::connection{ client };
+		const size_t baseline = unconnected.memory_usage();
+		EXPECT_LT(0, baseline);
+		EXPECT_EQ(baseline, cconn.memory_usage());
+		EXPECT_EQ(baseline, sconn.memory_usage());
+	}
+
+	TEST_F(ConnectionMemory, queued_stream)
+	{
+		const size_t baseline = sconn.memory_usage();
+
+		// the server queues the stream until it's accepted
+		static constexpr std::string_view message = "queued";
+		std::optional<error_code> write_ec;
+		cstream.async_write_all(boost::asio::buffer(message), capture(write_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value() && sconn.memory_usage() > baseline; });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		EXPECT_LT(baseline, sconn.memory_usage());
+
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(sstream, capture(accept_ec));
+		run_until(context, [&]
+		{ return accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+		EXPECT_EQ(baseline, sconn.memory_usage());
+	}
+
+	TEST_F(ConnectionMemory, drained_readable)
+	{
+		static constexpr std::string_view message = "readable";
+		std::optional<error_code> write_ec;
+		cstream.async_write_all(boost::asio::buffer(message), capture(write_ec));
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(sstream, capture(accept_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value() && accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+		const size_t baseline = sconn.memory_usage();
+
+		// the caller's spare capacity isn't kept once the ids are handed over
+		auto ids = std::vector<quic::stream_id>{};
+		ids.reserve(64);
+		std::optional<error_code> wait_ec;
+		sconn.async_wait_readable(ids, capture(wait_ec));
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+		EXPECT_FALSE(ids.empty());
+		EXPECT_EQ(baseline, sconn.memory_usage());
+	}
+
+} // namespace nexus
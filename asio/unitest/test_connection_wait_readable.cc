@@ -0,0 +1,212 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	// streams are opened one by one rather than with the fixture's cstream
+	// and sstream, which stay unused
+	class WaitReadable : public test::client_server
+	{
+	protected:
+		std::array<quic::stream, 3> sstreams{ quic::stream{ sconn }, quic::stream{ sconn }, quic::stream{ sconn } };
+		std::array<quic::stream, 3> cstreams{ quic::stream{ cconn }, quic::stream{ cconn }, quic::stream{ cconn } };
+
+		void SetUp() override
+		{
+			acceptor.listen(16);
+
+			std::optional<error_code> accept_ec;
+			acceptor.async_accept(sconn, capture(accept_ec));
+
+			for (auto& s : cstreams)
+			{
+				std::optional<error_code> connect_ec;
+				cconn.async_connect(s, capture(connect_ec));
+				run_until(context, [&]
+				{ return connect_ec.has_value(); });
+				ASSERT_TRUE(connect_ec);
+				ASSERT_EQ(ok, *connect_ec);
+				write(s, "a");
+			}
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+
+			for (auto& s : sstreams)
+			{
+				std::optional<error_code> stream_accept_ec;
+				sconn.async_accept(s, capture(stream_accept_ec));
+				run_until(context, [&]
+				{ return stream_accept_ec.has_value(); });
+				ASSERT_TRUE(stream_accept_ec);
+				ASSERT_EQ(ok, *stream_accept_ec);
+			}
+		}
+
+		void write(quic::stream& s, std::string_view data)
+		{
+			std::optional<error_code> write_ec;
+			s.async_write_some(boost::asio::buffer(data), capture(write_ec));
+			run_until(context, [&]
+			{ return write_ec.has_value(); });
+			ASSERT_TRUE(write_ec);
+			ASSERT_EQ(ok, *write_ec);
+			s.flush();
+		}
+
+		void read(quic::stream& s)
+		{
+			auto data = std::array<char, 16>{};
+			error_code ec;
+			s.read_some(boost::asio::buffer(data), ec);
+			ASSERT_EQ(ok, ec);
+		}
+	};
+
+	TEST_F(WaitReadable, not_connected)
+	{
+		auto conn = quic::connection{ acceptor };
+		auto ids = std::vector<quic::stream_id>{};
+		std::optional<error_code> wait_ec;
+		conn.async_wait_readable(ids, capture(wait_ec));
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(errc::not_connected, *wait_ec);
+	}
+
+	TEST_F(WaitReadable, batch)
+	{
+		auto ids = std::vector<quic::stream_id>{};
+		std::optional<error_code> wait_ec;
+		sconn.async_wait_readable(ids, capture(wait_ec));
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+
+		auto expected = std::vector<quic::stream_id>{};
+		for (auto& s : sstreams)
+		{
+			expected.push_back(s.id());
+		}
+		// everything ready within one engine pass comes back together, but
+		// loopback may split the writes across passes
+		for (int i = 0; i < 3 && ids.size() < expected.size(); i++)
+		{
+			auto more = std::vector<quic::stream_id>{};
+			wait_ec.reset();
+			sconn.async_wait_readable(more, capture(wait_ec));
+			run_until(context, [&]
+			{ return wait_ec.has_value(); });
+			ASSERT_TRUE(wait_ec);
+			ids.insert(ids.end(), more.begin(), more.end());
+		}
+		std::sort(ids.begin(), ids.end());
+		EXPECT_EQ(expected, ids);
+	}
+
+	TEST_F(WaitReadable, rearmed_by_read)
+	{
+		auto ids = std::vector<quic::stream_id>{};
+		std::optional<error_code> wait_ec;
+		for (int i = 0; i < 3 && ids.size() < sstreams.size(); i++)
+		{
+			auto more = std::vector<quic::stream_id>{};
+			wait_ec.reset();
+			sconn.async_wait_readable(more, capture(wait_ec));
+			run_until(context, [&]
+			{ return wait_ec.has_value(); });
+			ASSERT_TRUE(wait_ec);
+			ids.insert(ids.end(), more.begin(), more.end());
+		}
+		ASSERT_EQ(sstreams.size(), ids.size());
+		for (auto& s : sstreams)
+		{
+			read(s);
+		}
+
+		wait_ec.reset();
+		ids.clear();
+		sconn.async_wait_readable(ids, capture(wait_ec));
+		context.poll();
+		ASSERT_FALSE(wait_ec); // nothing new to read
+
+		write(cstreams[1], "b");
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+		ASSERT_EQ(1, ids.size());
+		EXPECT_EQ(sstreams[1].id(), ids[0]);
+	}
+
+	TEST_F(WaitReadable, rearmed_by_non_blocking_read)
+	{
+		auto ids = std::vector<quic::stream_id>{};
+		std::optional<error_code> wait_ec;
+		for (int i = 0; i < 3 && ids.size() < sstreams.size(); i++)
+		{
+			auto more = std::vector<quic::stream_id>{};
+			wait_ec.reset();
+			sconn.async_wait_readable(more, capture(wait_ec));
+			run_until(context, [&]
+			{ return wait_ec.has_value(); });
+			ASSERT_TRUE(wait_ec);
+			ids.insert(ids.end(), more.begin(), more.end());
+		}
+		ASSERT_EQ(sstreams.size(), ids.size());
+
+		// drained without a read operation for on_read() to finish
+		sstreams[2].non_blocking(true);
+		read(sstreams[2]);
+		auto data = std::array<char, 16>{};
+		error_code ec;
+		sstreams[2].read_some(boost::asio::buffer(data), ec);
+		EXPECT_EQ(errc::operation_would_block, ec);
+
+		wait_ec.reset();
+		ids.clear();
+		sconn.async_wait_readable(ids, capture(wait_ec));
+		write(cstreams[2], "b");
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+		ASSERT_EQ(1, ids.size());
+		EXPECT_EQ(sstreams[2].id(), ids[0]);
+	}
+
+	TEST_F(WaitReadable, close_cancels_wait)
+	{
+		auto ids = std::vector<quic::stream_id>{};
+		for (auto& s : sstreams)
+		{
+			read(s);
+		}
+		std::optional<error_code> wait_ec;
+		sconn.async_wait_readable(ids, capture(wait_ec));
+		sconn.close();
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(quic::connection_error::aborted, *wait_ec);
+	}
+
+} // namespace nexus
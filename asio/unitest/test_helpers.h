@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+#include <gtest/gtest.h>
+#include <boost/asio/io_context.hpp>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_server.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "certificate.h"
+
+namespace test
+{
+
+	inline const error_code ok;
+
+	inline auto capture(std::optional<error_code>& ec)
+	{
+		return [&](error_code e, size_t = 0)
+		{ ec = e; };
+	}
+
+	inline auto capture(std::optional<error_code>& ec, size_t& bytes)
+	{
+		return [&](error_code e, size_t n)
+		{
+			ec = e;
+			bytes = n;
+		};
+	}
+
+	// run handlers until `done`, or for about ten seconds
+	template<typename Predicate>
+	void run_until(boost::asio::io_context& context, Predicate&& done)
+	{
+		for (int i = 0; i < 1000 && !done(); i++)
+		{
+			context.run_one_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	// a client connected to a server over loopback. SetUp() connects cstream,
+	// which opens cconn, and accepts sconn. sstream is left for the test to
+	// accept, since the server only sees a stream once it carries data
+	class client_server : public testing::Test
+	{
+	protected:
+		static constexpr const char* alpn = "\04quic";
+		boost::asio::io_context context;
+		global::context global = global::init_client_server();
+		ssl::context ssl = init_server_context(alpn);
+		ssl::context sslc = init_client_context(alpn);
+		quic::server server;
+		boost::asio::ip::address localhost = boost::asio::ip::make_address("127.0.0.1");
+		quic::acceptor acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+		quic::connection sconn{ acceptor };
+		quic::stream sstream{ sconn };
+		quic::client client;
+		quic::connection cconn{ client, acceptor.local_endpoint(), "host" };
+		quic::stream cstream{ cconn };
+
+		explicit client_server(const quic::settings& server_settings = quic::default_server_settings(),
+			const quic::settings& client_settings = quic::default_client_settings())
+			: server(context.get_executor(), server_settings),
+			  client(context.get_executor(), udp::endpoint{}, sslc, client_settings)
+		{
+		}
+
+		void SetUp() override
+		{
+			acceptor.listen(16);
+
+			std::optional<error_code> connect_ec;
+			cconn.async_connect(cstream, capture(connect_ec));
+
+			std::optional<error_code> accept_ec;
+			acceptor.async_accept(sconn, capture(accept_ec));
+
+			run_until(context, [&]
+			{ return connect_ec && accept_ec; });
+			ASSERT_TRUE(connect_ec);
+			ASSERT_EQ(ok, *connect_ec);
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+		}
+
+		// write to cstream so the server sees it, and accept it as sstream
+		void open_stream(std::string_view data)
+		{
+			std::optional<error_code> accept_ec;
+			sconn.async_accept(sstream, capture(accept_ec));
+			std::optional<error_code> write_ec;
+			cstream.async_write_some(boost::asio::buffer(data), capture(write_ec));
+			run_until(context, [&]
+			{ return accept_ec && write_ec; });
+			ASSERT_TRUE(write_ec);
+			ASSERT_EQ(ok, *write_ec);
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+		}
+	};
+
+} // namespace test
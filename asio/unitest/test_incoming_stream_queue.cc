@@ -0,0 +1,95 @@
+#include "quic/detail/incoming_stream_queue.h"
+#include <gtest/gtest.h>
+
+namespace quic::detail
+{
+
+	// the queue never dereferences its handles
+	inline lsquic_stream* handle(uintptr_t i)
+	{
+		return reinterpret_cast<lsquic_stream*>(i + 1);
+	}
+
+	TEST(IncomingStreamQueue, empty_until_pushed)
+	{
+		auto q = incoming_stream_queue{ 100 };
+		EXPECT_TRUE(q.empty());
+		EXPECT_FALSE(q.full());
+		EXPECT_EQ(0, q.size());
+	}
+
+	TEST(IncomingStreamQueue, zero_limit_is_full)
+	{
+		auto q = incoming_stream_queue{};
+		EXPECT_TRUE(q.full());
+	}
+
+	TEST(IncomingStreamQueue, grows_to_limit)
+	{
+		static constexpr uint32_t limit = 100;
+		auto q = incoming_stream_queue{ limit };
+		for (uint32_t i = 0; i < limit; i++)
+		{
+			ASSERT_FALSE(q.full());
+			q.push_back(handle(i));
+		}
+		EXPECT_TRUE(q.full());
+		EXPECT_EQ(limit, q.size());
+		for (uint32_t i = 0; i < limit; i++)
+		{
+			EXPECT_EQ(handle(i), q.front());
+			q.pop_front();
+		}
+		EXPECT_TRUE(q.empty());
+	}
+
+	TEST(IncomingStreamQueue, grows_while_wrapped)
+	{
+		auto q = incoming_stream_queue{ 64 };
+		uintptr_t pushed = 0;
+		uintptr_t popped = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			q.push_back(handle(pushed++));
+		}
+		for (int i = 0; i < 2; i++)
+		{
+			EXPECT_EQ(handle(popped++), q.front());
+			q.pop_front();
+		}
+		// the ring wraps past the end of its first array before growing
+		for (int i = 0; i < 10; i++)
+		{
+			q.push_back(handle(pushed++));
+		}
+		EXPECT_EQ(pushed - popped, q.size());
+		while (!q.empty())
+		{
+			EXPECT_EQ(handle(popped++), q.front());
+			q.pop_front();
+		}
+		EXPECT_EQ(pushed, popped);
+	}
+
+	TEST(IncomingStreamQueue, move)
+	{
+		auto a = incoming_stream_queue{ 8 };
+		a.push_back(handle(0));
+		a.push_back(handle(1));
+
+		auto b = std::move(a);
+		EXPECT_TRUE(a.empty());
+		ASSERT_EQ(2, b.size());
+		EXPECT_EQ(handle(0), b.front());
+
+		auto c = incoming_stream_queue{};
+		c = std::move(b);
+		EXPECT_TRUE(b.empty());
+		ASSERT_EQ(2, c.size());
+		EXPECT_EQ(handle(0), c.front());
+		c.pop_front();
+		EXPECT_EQ(handle(1), c.front());
+		EXPECT_FALSE(c.full());
+	}
+
+} // namespace quic::detail
@@ -0,0 +1,124 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+		// what each connection is charged: its window at the most it may grow
+		size_t charged_window(const quic::settings& s)
+		{
+			return std::max(s.connection_flow_control_window, s.max_connection_flow_control_window);
+		}
+
+		// room for one connection's window, and half of another's
+		quic::settings budget_settings()
+		{
+			auto s = quic::default_server_settings();
+			s.memory_budget = charged_window(s) * 3 / 2;
+			return s;
+		}
+
+	} // anonymous namespace
+
+	class MemoryBudget : public test::client_server
+	{
+	protected:
+		quic::settings settings = budget_settings();
+
+		MemoryBudget()
+			: client_server(budget_settings())
+		{
+		}
+	};
+
+	TEST_F(MemoryBudget, connection_charged_its_window)
+	{
+		const auto stats = server.memory_stats();
+		EXPECT_EQ(settings.memory_budget, stats.budget);
+		EXPECT_EQ(charged_window(settings), stats.used);
+		EXPECT_FALSE(stats.pressure);
+
+		// the client has no budget, but still counts what it holds
+		const auto cstats = client.memory_stats();
+		EXPECT_EQ(0, cstats.budget);
+		EXPECT_EQ(charged_window(quic::default_client_settings()), cstats.used);
+		EXPECT_FALSE(cstats.pressure);
+	}
+
+	TEST_F(MemoryBudget, read_ahead_over_budget)
+	{
+		static constexpr std::string_view message = "budget";
+		std::optional<error_code> write_ec;
+		cstream.async_write_all(boost::asio::buffer(message), capture(write_ec));
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(sstream, capture(accept_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value() && accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+
+		// read it first, so there's nothing left to fill the read-ahead buffer
+		char data[16];
+		std::optional<error_code> read_ec;
+		sstream.async_read(boost::asio::buffer(data, message.size()), capture(read_ec));
+		run_until(context, [&]
+		{ return read_ec.has_value(); });
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+
+		const size_t used = server.memory_stats().used;
+		error_code ec;
+		sstream.set_read_ahead(settings.memory_budget, ec);
+		EXPECT_EQ(errc::no_buffer_space, ec);
+		EXPECT_EQ(used, server.memory_stats().used);
+
+		sstream.set_read_ahead(4096, ec);
+		EXPECT_EQ(ok, ec);
+		EXPECT_EQ(used + 4096, server.memory_stats().used);
+
+		sstream.set_read_ahead(0, ec);
+		EXPECT_EQ(ok, ec);
+		EXPECT_EQ(used, server.memory_stats().used);
+	}
+
+	TEST_F(MemoryBudget, connection_refused_over_budget)
+	{
+		const size_t used = server.memory_stats().used;
+
+		auto sconn2 = quic::connection{ acceptor };
+		std::optional<error_code> accept_ec;
+		acceptor.async_accept(sconn2, capture(accept_ec));
+
+		auto cconn2 = quic::connection{ client, acceptor.local_endpoint(), "host" };
+		auto cstream2 = quic::stream{ cconn2 };
+		std::optional<error_code> connect_ec;
+		cconn2.async_connect(cstream2, capture(connect_ec));
+
+		run_until(context, [&]
+		{ return connect_ec.has_value(); });
+		ASSERT_TRUE(connect_ec);
+		EXPECT_NE(ok, *connect_ec);
+		EXPECT_FALSE(accept_ec);
+		EXPECT_EQ(used, server.memory_stats().used);
+
+		acceptor.close();
+		context.poll();
+	}
+
+} // namespace nexus
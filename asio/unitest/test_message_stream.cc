@@ -0,0 +1,197 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <optional>
+#include <string>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_message_stream.h"
+#include "quic/quic_stream.h"
+#include "quic/detail/varint.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class MessageStream : public test::client_server
+	{
+	protected:
+		// write the first message so the server can accept the stream
+		void accept_stream()
+		{
+			std::optional<error_code> accept_ec;
+			sconn.async_accept(sstream, capture(accept_ec));
+			run_until(context, [&]
+			{ return accept_ec.has_value(); });
+			ASSERT_TRUE(accept_ec);
+			ASSERT_EQ(ok, *accept_ec);
+		}
+	};
+
+	TEST(Varint, round_trip)
+	{
+		namespace varint = quic::detail::varint;
+		for (uint64_t value : { uint64_t{ 0 }, uint64_t{ 63 }, uint64_t{ 64 }, uint64_t{ 16383 },
+				 uint64_t{ 16384 }, uint64_t{ 1073741823 }, uint64_t{ 1073741824 }, varint::max_value })
+		{
+			char buf[varint::max_size];
+			const size_t n = varint::encode(value, buf);
+			EXPECT_EQ(varint::size(value), n);
+			uint64_t decoded = 0;
+			EXPECT_EQ(0, varint::decode(buf, n - 1, decoded));
+			EXPECT_EQ(n, varint::decode(buf, n, decoded));
+			EXPECT_EQ(value, decoded);
+		}
+	}
+
+	TEST_F(MessageStream, send_receive_batch)
+	{
+		// small messages are coalesced around the large ones, which is
+		// bigger than the receiver's input buffer
+		auto payloads = std::vector<std::string>{
+			"first", "", std::string(300, 's'),
+			std::string(3 * quic::message_stream::input_size, 'L'), "last" };
+		auto buffers = std::vector<boost::asio::const_buffer>{};
+		size_t expected_bytes = 0;
+		for (const auto& p : payloads)
+		{
+			buffers.push_back(boost::asio::buffer(p));
+			expected_bytes += quic::detail::varint::size(p.size()) + p.size();
+		}
+
+		auto client_messages = quic::message_stream{ cstream };
+		std::optional<error_code> send_ec;
+		size_t sent = 0;
+		client_messages.async_send(buffers, [&](error_code ec, size_t bytes)
+		{
+			send_ec = ec;
+			sent = bytes;
+		});
+
+		accept_stream();
+		auto server_messages = quic::message_stream{ sstream };
+		auto received = std::vector<quic::message_stream::message>{};
+		std::optional<error_code> receive_ec;
+		while (received.size() < payloads.size())
+		{
+			receive_ec.reset();
+			size_t count = 0;
+			server_messages.async_receive(received, [&](error_code ec, size_t n)
+			{
+				receive_ec = ec;
+				count = n;
+			});
+			run_until(context, [&]
+			{ return receive_ec.has_value(); });
+			ASSERT_TRUE(receive_ec);
+			ASSERT_EQ(ok, *receive_ec);
+			EXPECT_LT(0, count);
+		}
+
+		run_until(context, [&]
+		{ return send_ec.has_value(); });
+		ASSERT_TRUE(send_ec);
+		EXPECT_EQ(ok, *send_ec);
+		EXPECT_EQ(expected_bytes, sent);
+
+		ASSERT_EQ(payloads.size(), received.size());
+		for (size_t i = 0; i < payloads.size(); i++)
+		{
+			EXPECT_EQ(payloads[i], std::string(received[i].begin(), received[i].end()));
+		}
+	}
+
+	TEST_F(MessageStream, message_too_large)
+	{
+		const auto payload = std::string(100, 'x');
+		const auto buffers = std::array<boost::asio::const_buffer, 1>{ boost::asio::buffer(payload) };
+		auto client_messages = quic::message_stream{ cstream };
+		std::optional<error_code> send_ec;
+		client_messages.async_send(buffers, capture(send_ec));
+
+		accept_stream();
+		auto server_messages = quic::message_stream{ sstream, 64 };
+		auto received = std::vector<quic::message_stream::message>{};
+		std::optional<error_code> receive_ec;
+		server_messages.async_receive(received, capture(receive_ec));
+		run_until(context, [&]
+		{ return receive_ec.has_value(); });
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(errc::message_size, *receive_ec);
+		EXPECT_TRUE(received.empty());
+	}
+
+	TEST_F(MessageStream, eof)
+	{
+		const auto payload = std::string(10, 'x');
+		const auto buffers = std::array<boost::asio::const_buffer, 1>{ boost::asio::buffer(payload) };
+		auto client_messages = quic::message_stream{ cstream };
+		std::optional<error_code> send_ec;
+		client_messages.async_send(buffers, capture(send_ec));
+		run_until(context, [&]
+		{ return send_ec.has_value(); });
+		ASSERT_TRUE(send_ec);
+		ASSERT_EQ(ok, *send_ec);
+		cstream.shutdown(1);
+
+		accept_stream();
+		auto server_messages = quic::message_stream{ sstream };
+		auto received = std::vector<quic::message_stream::message>{};
+		std::optional<error_code> receive_ec;
+		size_t count = 0;
+		server_messages.async_receive(received, capture(receive_ec, count));
+		run_until(context, [&]
+		{ return receive_ec.has_value(); });
+		ASSERT_TRUE(receive_ec);
+		ASSERT_EQ(ok, *receive_ec);
+		ASSERT_EQ(1, count);
+		EXPECT_EQ(payload, std::string(received[0].begin(), received[0].end()));
+
+		receive_ec.reset();
+		server_messages.async_receive(received, capture(receive_ec, count));
+		run_until(context, [&]
+		{ return receive_ec.has_value(); });
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(quic::stream_error::eof, *receive_ec);
+		EXPECT_EQ(0, count);
+	}
+
+	TEST_F(MessageStream, truncated)
+	{
+		// a prefix promising 10 bytes, followed by only 3
+		char prefix[quic::detail::varint::max_size];
+		const size_t n = quic::detail::varint::encode(10, prefix);
+		const auto buffers = std::array<boost::asio::const_buffer, 2>{
+			boost::asio::buffer(prefix, n), boost::asio::buffer("abc", 3) };
+		std::optional<error_code> write_ec;
+		cstream.async_write_all(buffers, capture(write_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		ASSERT_EQ(ok, *write_ec);
+		cstream.shutdown(1);
+
+		accept_stream();
+		auto server_messages = quic::message_stream{ sstream };
+		auto received = std::vector<quic::message_stream::message>{};
+		std::optional<error_code> receive_ec;
+		server_messages.async_receive(received, capture(receive_ec));
+		run_until(context, [&]
+		{ return receive_ec.has_value(); });
+		ASSERT_TRUE(receive_ec);
+		EXPECT_EQ(errc::bad_message, *receive_ec);
+		EXPECT_TRUE(received.empty());
+	}
+
+} // namespace nexus
@@ -0,0 +1,144 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <optional>
+#include <string>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_rpc.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class Rpc : public test::client_server
+	{
+	protected:
+		// let the server's streams see the close and release their handlers
+		void TearDown() override
+		{
+			error_code ec;
+			sconn.close(ec);
+			cconn.close(ec);
+			context.poll();
+		}
+	};
+
+	TEST_F(Rpc, calls)
+	{
+		quic::serve_rpc(sconn, 4, [](quic::rpc_message request, quic::rpc_reply reply)
+		{
+			const auto body = request.body();
+			auto response = std::vector<char>{ '>' };
+			response.insert(response.end(), body.begin(), body.end());
+			reply(std::move(response));
+		});
+
+		auto rpc = quic::rpc_client{ cconn, 2 };
+		EXPECT_EQ(2, rpc.streams());
+
+		// more calls than streams, so some share one
+		static constexpr size_t count = 10;
+		auto requests = std::vector<std::string>{};
+		for (size_t i = 0; i < count; i++)
+		{
+			requests.push_back("request " + std::to_string(i));
+		}
+		requests.push_back(std::string(200000, 'b'));
+		auto results = std::vector<std::optional<error_code>>(requests.size());
+		auto responses = std::vector<std::string>(requests.size());
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			rpc.async_call(boost::asio::buffer(requests[i]),
+				[&, i](error_code ec, quic::rpc_message response)
+				{
+					results[i] = ec;
+					const auto body = response.body();
+					responses[i].assign(body.begin(), body.end());
+				});
+		}
+		run_until(context, [&]
+		{ return std::all_of(results.begin(), results.end(), [](const auto& r) { return r.has_value(); }); });
+
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			ASSERT_TRUE(results[i]);
+			EXPECT_EQ(ok, *results[i]);
+			EXPECT_EQ(">" + requests[i], responses[i]);
+		}
+	}
+
+	TEST_F(Rpc, deferred_reply)
+	{
+		auto replies = std::vector<quic::rpc_reply>{};
+		quic::serve_rpc(sconn, 1, [&](quic::rpc_message, quic::rpc_reply reply)
+		{
+			replies.push_back(std::move(reply));
+		});
+
+		auto rpc = quic::rpc_client{ cconn, 1 };
+		static constexpr std::string_view first = "first";
+		static constexpr std::string_view second = "second";
+		std::optional<error_code> first_ec;
+		std::string first_response;
+		rpc.async_call(boost::asio::buffer(first), [&](error_code ec, quic::rpc_message response)
+		{
+			first_ec = ec;
+			const auto body = response.body();
+			first_response.assign(body.begin(), body.end());
+		});
+		std::optional<error_code> second_ec;
+		std::string second_response;
+		rpc.async_call(boost::asio::buffer(second), [&](error_code ec, quic::rpc_message response)
+		{
+			second_ec = ec;
+			const auto body = response.body();
+			second_response.assign(body.begin(), body.end());
+		});
+		run_until(context, [&]
+		{ return replies.size() == 2; });
+		ASSERT_EQ(2, replies.size());
+
+		// answered out of order, and matched by id
+		replies[1](std::vector<char>{ '2' });
+		replies[0](std::vector<char>{ '1' });
+		run_until(context, [&]
+		{ return first_ec && second_ec; });
+		ASSERT_TRUE(first_ec);
+		EXPECT_EQ(ok, *first_ec);
+		EXPECT_EQ("1", first_response);
+		ASSERT_TRUE(second_ec);
+		EXPECT_EQ(ok, *second_ec);
+		EXPECT_EQ("2", second_response);
+	}
+
+	TEST_F(Rpc, destroy_cancels)
+	{
+		static constexpr std::string_view request = "unanswered";
+		std::optional<error_code> call_ec;
+		{
+			auto rpc = quic::rpc_client{ cconn, 1 };
+			rpc.async_call(boost::asio::buffer(request), [&](error_code ec, quic::rpc_message)
+			{ call_ec = ec; });
+			context.poll();
+			EXPECT_FALSE(call_ec);
+		}
+		run_until(context, [&]
+		{ return call_ec.has_value(); });
+		ASSERT_TRUE(call_ec);
+		EXPECT_EQ(errc::operation_canceled, *call_ec);
+	}
+
+} // namespace nexus
@@ -0,0 +1,209 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <string>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class Cork : public test::client_server
+	{
+	};
+
+	TEST_F(Cork, not_connected)
+	{
+		auto s = quic::stream{ cconn };
+		error_code ec;
+		s.cork(ec);
+		EXPECT_EQ(errc::not_connected, ec);
+		s.uncork(ec);
+		EXPECT_EQ(errc::not_connected, ec);
+	}
+
+	TEST_F(Cork, uncork_idle)
+	{
+		// nothing gathered and no write pending
+		error_code ec;
+		cstream.cork(ec);
+		EXPECT_EQ(ok, ec);
+		cstream.uncork(ec);
+		EXPECT_EQ(ok, ec);
+		{
+			auto guard = quic::cork_guard{ cstream };
+		}
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		EXPECT_TRUE(cstream.is_open());
+	}
+
+	TEST_F(Cork, coalesce)
+	{
+		auto expected = std::string{};
+		{
+			auto guard = quic::cork_guard{ cstream };
+			for (int i = 0; i < 100; i++)
+			{
+				const auto message = std::to_string(i) + ';';
+				expected += message;
+				// corked writes complete without touching the engine
+				error_code ec;
+				ASSERT_EQ(message.size(), cstream.write_some(boost::asio::buffer(message), ec));
+				ASSERT_EQ(ok, ec);
+			}
+		}
+		cstream.shutdown(1);
+
+		auto received = std::string{};
+		auto data = std::array<char, 4096>{};
+		std::optional<error_code> read_ec;
+		std::function<void(error_code, size_t)> on_read = [&](error_code ec, size_t bytes)
+		{
+			if (ec || bytes == 0)
+			{
+				read_ec = ec;
+				return;
+			}
+			received.append(data.data(), bytes);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		};
+		sconn.async_accept(sstream, [&](error_code ec)
+		{
+			ASSERT_EQ(ok, ec);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		});
+
+		run_until(context, [&]
+		{ return read_ec.has_value(); });
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		EXPECT_EQ(expected, received);
+	}
+
+	TEST_F(Cork, threshold)
+	{
+		// past the gather threshold, so data goes out while still corked
+		cstream.cork();
+		auto chunk = std::string(16 * 1024, 'x');
+		for (int i = 0; i < 5; i++)
+		{
+			// the fifth waits for the gathered bytes to go out
+			std::optional<error_code> write_ec;
+			cstream.async_write_some(boost::asio::buffer(chunk), capture(write_ec));
+			run_until(context, [&]
+			{ return write_ec.has_value(); });
+			ASSERT_TRUE(write_ec);
+			EXPECT_EQ(ok, *write_ec);
+		}
+
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(sstream, capture(accept_ec));
+		auto data = std::array<char, 4096>{};
+		std::optional<error_code> read_ec;
+		size_t bytes = 0;
+		run_until(context, [&]
+		{ return accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+
+		sstream.async_read_some(boost::asio::buffer(data), [&](error_code ec, size_t n)
+		{
+			read_ec = ec;
+			bytes = n;
+		});
+		run_until(context, [&]
+		{ return read_ec.has_value(); });
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		EXPECT_LT(0, bytes);
+		cstream.uncork();
+	}
+
+	// gather bytes that completed their writes, then end the stream without
+	// uncorking. the server has to see every one of them before the FIN
+	class CorkDrain : public Cork
+	{
+	protected:
+		std::string expected;
+
+		void gather()
+		{
+			cstream.cork();
+			const auto chunk = std::string(1024, 'g');
+			while (expected.size() + chunk.size() < 63 * 1024)
+			{
+				error_code ec;
+				ASSERT_EQ(chunk.size(), cstream.write_some(boost::asio::buffer(chunk), ec));
+				ASSERT_EQ(ok, ec);
+				expected += chunk;
+			}
+		}
+
+		void expect_received()
+		{
+			auto received = std::string{};
+			auto data = std::array<char, 4096>{};
+			std::optional<error_code> read_ec;
+			std::function<void(error_code, size_t)> on_read = [&](error_code ec, size_t bytes)
+			{
+				if (ec || bytes == 0)
+				{
+					read_ec = ec;
+					return;
+				}
+				received.append(data.data(), bytes);
+				sstream.async_read_some(boost::asio::buffer(data), on_read);
+			};
+			sconn.async_accept(sstream, [&](error_code ec)
+			{
+				ASSERT_EQ(ok, ec);
+				sstream.async_read_some(boost::asio::buffer(data), on_read);
+			});
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			EXPECT_EQ(expected.size(), received.size());
+			EXPECT_EQ(expected, received);
+		}
+	};
+
+	TEST_F(CorkDrain, shutdown)
+	{
+		gather();
+		cstream.shutdown(1);
+		expect_received();
+	}
+
+	TEST_F(CorkDrain, close)
+	{
+		gather();
+		std::optional<error_code> close_ec;
+		cstream.async_close(capture(close_ec));
+		expect_received();
+		std::optional<error_code> sclose_ec;
+		sstream.async_close(capture(sclose_ec));
+		run_until(context, [&]
+		{ return close_ec.has_value(); });
+		ASSERT_TRUE(close_ec);
+		EXPECT_EQ(ok, *close_ec);
+	}
+
+} // namespace nexus
@@ -0,0 +1,133 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <coroutine>
+#include <optional>
+#include <string>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+		// runs eagerly and is never awaited, which is all these tests need
+		struct detached
+		{
+			struct promise_type
+			{
+				detached get_return_object()
+				{
+					return {};
+				}
+				std::suspend_never initial_suspend() noexcept
+				{
+					return {};
+				}
+				std::suspend_never final_suspend() noexcept
+				{
+					return {};
+				}
+				void return_void()
+				{
+				}
+				void unhandled_exception()
+				{
+					std::terminate();
+				}
+			};
+		};
+
+	} // anonymous namespace
+
+	class Coroutine : public test::client_server
+	{
+	};
+
+	TEST_F(Coroutine, not_connected)
+	{
+		auto s = quic::stream{ sconn };
+		std::optional<error_code> read_ec;
+		auto read = [&]() -> detached
+		{
+			auto data = std::array<char, 16>{};
+			try
+			{
+				co_await s.co_read_some(boost::asio::buffer(data));
+				read_ec = ok;
+			}
+			catch (const system_error& e)
+			{
+				read_ec = e.code();
+			}
+		};
+		read();
+		EXPECT_FALSE(read_ec); // resumed through the executor, not inline
+		context.poll();
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(errc::bad_file_descriptor, *read_ec);
+	}
+
+	TEST_F(Coroutine, echo)
+	{
+		static constexpr std::string_view message = "hello coroutine";
+
+		auto received = std::string{};
+		std::optional<error_code> server_ec;
+		auto server_side = [&]() -> detached
+		{
+			error_code ec;
+			co_await sconn.co_accept(sstream, ec);
+			if (ec)
+			{
+				server_ec = ec;
+				co_return;
+			}
+			auto data = std::array<char, 64>{};
+			for (;;)
+			{
+				const size_t bytes = co_await sstream.co_read_some(boost::asio::buffer(data), ec);
+				if (ec || bytes == 0)
+				{
+					break;
+				}
+				received.append(data.data(), bytes);
+			}
+			server_ec = ec;
+		};
+
+		std::optional<error_code> client_ec;
+		size_t written = 0;
+		auto client_side = [&]() -> detached
+		{
+			error_code ec;
+			written = co_await cstream.co_write_all(boost::asio::buffer(message), ec);
+			if (!ec)
+			{
+				cstream.shutdown(1, ec);
+			}
+			client_ec = ec;
+		};
+
+		server_side();
+		client_side();
+		run_until(context, [&]
+		{ return client_ec.has_value() && server_ec.has_value(); });
+		ASSERT_TRUE(client_ec);
+		EXPECT_EQ(ok, *client_ec);
+		EXPECT_EQ(message.size(), written);
+		ASSERT_TRUE(server_ec);
+		EXPECT_EQ(ok, *server_ec);
+		EXPECT_EQ(message, received);
+	}
+
+} // namespace nexus
@@ -0,0 +1,137 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <optional>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+		using std::chrono::steady_clock;
+		using namespace std::chrono_literals;
+
+	} // anonymous namespace
+
+	class Deadline : public test::client_server
+	{
+	protected:
+		static constexpr std::string_view message = "hello world";
+
+		void SetUp() override
+		{
+			ASSERT_NO_FATAL_FAILURE(client_server::SetUp());
+			ASSERT_NO_FATAL_FAILURE(open_stream(message));
+		}
+	};
+
+	TEST_F(Deadline, read_timeout)
+	{
+		auto data = std::array<char, 16>{};
+		{
+			std::optional<error_code> read_ec;
+			sstream.async_read_some(boost::asio::buffer(data), steady_clock::now(), capture(read_ec));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec); // data was already there
+		}
+		{
+			const auto start = steady_clock::now();
+			std::optional<error_code> read_ec;
+			sstream.async_read_some(boost::asio::buffer(data), start + 20ms, capture(read_ec));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(errc::timed_out, *read_ec);
+			EXPECT_LE(start + 20ms, steady_clock::now());
+		}
+		EXPECT_TRUE(sstream.is_open());
+		{ // the stream can still be read
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), steady_clock::now() + 1s, capture(read_ec, bytes));
+			std::optional<error_code> write_ec;
+			cstream.async_write_some(boost::asio::buffer(message), capture(write_ec));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			EXPECT_EQ(message, std::string_view(data.data(), bytes));
+		}
+	}
+
+	TEST_F(Deadline, expired_deadline_ignores_later_reads)
+	{
+		auto data = std::array<char, 16>{};
+		{
+			std::optional<error_code> read_ec;
+			sstream.async_read_some(boost::asio::buffer(data), steady_clock::now() + 20ms, capture(read_ec));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+		}
+		// the first read's deadline passes while this one is pending
+		std::optional<error_code> read_ec;
+		sstream.async_read_some(boost::asio::buffer(data), capture(read_ec));
+		const auto limit = steady_clock::now() + 50ms;
+		while (steady_clock::now() < limit)
+		{
+			context.run_one_for(10ms);
+		}
+		EXPECT_FALSE(read_ec);
+
+		std::optional<error_code> write_ec;
+		cstream.async_write_some(boost::asio::buffer(message), capture(write_ec));
+		run_until(context, [&]
+		{ return read_ec.has_value(); });
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+	}
+
+	TEST_F(Deadline, accept_timeout)
+	{
+		auto s = quic::stream{ sconn };
+		std::optional<error_code> accept_ec;
+		sconn.async_accept(s, steady_clock::now() + 20ms, capture(accept_ec));
+		run_until(context, [&]
+		{ return accept_ec.has_value(); });
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(errc::timed_out, *accept_ec);
+		EXPECT_FALSE(s.is_open());
+
+		// the stream can be accepted again
+		auto c = quic::stream{ cconn };
+		std::optional<error_code> connect_ec;
+		cconn.async_connect(c, steady_clock::now() + 1s, capture(connect_ec));
+		run_until(context, [&]
+		{ return connect_ec.has_value(); });
+		ASSERT_TRUE(connect_ec);
+		EXPECT_EQ(ok, *connect_ec);
+
+		std::optional<error_code> write_ec;
+		c.async_write_some(boost::asio::buffer(message), steady_clock::now() + 1s, capture(write_ec));
+		accept_ec.reset();
+		sconn.async_accept(s, steady_clock::now() + 1s, capture(accept_ec));
+		run_until(context, [&]
+		{ return accept_ec.has_value() && write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		ASSERT_TRUE(accept_ec);
+		EXPECT_EQ(ok, *accept_ec);
+		EXPECT_TRUE(s.is_open());
+	}
+
+} // namespace nexus
@@ -0,0 +1,142 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_fanout.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class Fanout : public test::client_server
+	{
+	protected:
+		std::vector<std::unique_ptr<quic::stream>> cstreams;
+		std::vector<std::unique_ptr<quic::stream>> sstreams;
+		static constexpr size_t count = 3;
+
+		void SetUp() override
+		{
+			ASSERT_NO_FATAL_FAILURE(client_server::SetUp());
+
+			for (size_t i = 0; i < count; i++)
+			{
+				auto& s = cstreams.emplace_back(std::make_unique<quic::stream>(cconn));
+				std::optional<error_code> ec;
+				cconn.async_connect(*s, capture(ec));
+				run_until(context, [&]
+				{ return ec.has_value(); });
+				ASSERT_TRUE(ec);
+				ASSERT_EQ(ok, *ec);
+			}
+		}
+
+		// accept a server stream for each client stream, and read all it sent
+		void read_all(std::string_view expected)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				auto& s = sstreams.emplace_back(std::make_unique<quic::stream>(sconn));
+				std::optional<error_code> accept_ec;
+				sconn.async_accept(*s, capture(accept_ec));
+				run_until(context, [&]
+				{ return accept_ec.has_value(); });
+				ASSERT_TRUE(accept_ec);
+				ASSERT_EQ(ok, *accept_ec);
+
+				auto data = std::vector<char>(expected.size());
+				std::optional<error_code> read_ec;
+				s->async_read(boost::asio::buffer(data), capture(read_ec));
+				run_until(context, [&]
+				{ return read_ec.has_value(); });
+				ASSERT_TRUE(read_ec);
+				EXPECT_EQ(ok, *read_ec);
+				EXPECT_EQ(expected, std::string_view(data.data(), data.size()));
+			}
+		}
+	};
+
+	TEST_F(Fanout, async_write)
+	{
+		auto text = std::string(100'000, 'x');
+		auto payload = std::make_shared<const std::vector<char>>(text.begin(), text.end());
+
+		std::optional<error_code> write_ec;
+		std::vector<error_code> results;
+		quic::async_write_fanout(context.get_executor(), cstreams, payload, [&](error_code ec, std::vector<error_code> r)
+		{
+			write_ec = ec;
+			results = std::move(r);
+		});
+		payload.reset(); // the write keeps it alive
+		read_all(text);
+
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		ASSERT_EQ(count, results.size());
+		for (const auto& r : results)
+		{
+			EXPECT_EQ(ok, r);
+		}
+	}
+
+	TEST_F(Fanout, closed_stream)
+	{
+		static constexpr std::string_view text = "broadcast";
+		auto payload = std::make_shared<const std::vector<char>>(text.begin(), text.end());
+
+		auto closed = quic::stream{ cconn };
+		auto streams = std::vector<quic::stream*>{ cstreams[0].get(), &closed, cstreams[1].get() };
+
+		std::optional<error_code> write_ec;
+		std::vector<error_code> results;
+		quic::async_write_fanout(context.get_executor(), streams, payload, [&](error_code ec, std::vector<error_code> r)
+		{
+			write_ec = ec;
+			results = std::move(r);
+		});
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(errc::bad_file_descriptor, *write_ec);
+		ASSERT_EQ(3, results.size());
+		EXPECT_EQ(ok, results[0]);
+		EXPECT_EQ(errc::bad_file_descriptor, results[1]);
+		EXPECT_EQ(ok, results[2]);
+	}
+
+	TEST_F(Fanout, empty)
+	{
+		auto payload = std::make_shared<const std::vector<char>>();
+		auto none = std::vector<quic::stream*>{};
+		std::optional<error_code> write_ec;
+		quic::async_write_fanout(context.get_executor(), none, payload,
+			[&](error_code ec, std::vector<error_code> r)
+			{
+				write_ec = ec;
+				EXPECT_TRUE(r.empty());
+			});
+		context.poll();
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+	}
+
+} // namespace nexus
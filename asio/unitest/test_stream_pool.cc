@@ -0,0 +1,84 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "quic/quic_stream_pool.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class StreamPool : public test::client_server
+	{
+	protected:
+		void connect(quic::stream& s)
+		{
+			std::optional<error_code> connect_ec;
+			cconn.async_connect(s, capture(connect_ec));
+			run_until(context, [&]
+			{ return connect_ec.has_value(); });
+			ASSERT_TRUE(connect_ec);
+			ASSERT_EQ(ok, *connect_ec);
+		}
+	};
+
+	TEST_F(StreamPool, reopen_after_reset)
+	{
+		const auto first = cstream.id();
+		cstream.reset();
+		EXPECT_FALSE(cstream.is_open());
+
+		connect(cstream);
+		EXPECT_TRUE(cstream.is_open());
+		EXPECT_NE(first, cstream.id());
+	}
+
+	TEST_F(StreamPool, reopen_while_open)
+	{
+		std::optional<error_code> connect_ec;
+		cconn.async_connect(cstream, capture(connect_ec));
+		context.poll();
+		ASSERT_TRUE(connect_ec);
+		EXPECT_EQ(errc::invalid_argument, *connect_ec);
+		EXPECT_TRUE(cstream.is_open());
+	}
+
+	TEST_F(StreamPool, recycle)
+	{
+		auto pool = quic::stream_pool{ cconn, 1 };
+		auto a = pool.acquire();
+		ASSERT_TRUE(a);
+		connect(*a);
+		auto id = a->id();
+		auto* recycled = a.get();
+
+		pool.release(std::move(a));
+		EXPECT_EQ(1, pool.size());
+
+		auto b = pool.acquire();
+		EXPECT_EQ(recycled, b.get()); // same object, reset and reusable
+		EXPECT_EQ(0, pool.size());
+		EXPECT_FALSE(b->is_open());
+		connect(*b);
+		EXPECT_NE(id, b->id());
+
+		auto c = pool.acquire();
+		pool.release(std::move(b));
+		pool.release(std::move(c)); // beyond max_idle
+		EXPECT_EQ(1, pool.size());
+	}
+
+} // namespace nexus
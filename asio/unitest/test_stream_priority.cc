@@ -0,0 +1,108 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "h3/h3_server.h"
+#include "h3/h3_client.h"
+#include "h3/h3_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+
+	} // anonymous namespace
+
+	class Priority : public test::client_server
+	{
+	};
+
+	TEST_F(Priority, not_connected)
+	{
+		auto s = quic::stream{ cconn };
+		error_code ec;
+		s.set_priority(1, ec);
+		EXPECT_EQ(errc::not_connected, ec);
+		s.priority(ec);
+		EXPECT_EQ(errc::not_connected, ec);
+	}
+
+	TEST_F(Priority, set)
+	{
+		cstream.set_priority(1);
+		EXPECT_EQ(1, cstream.priority());
+		cstream.set_priority(256);
+		EXPECT_EQ(256, cstream.priority());
+	}
+
+	TEST_F(Priority, out_of_range)
+	{
+		error_code ec;
+		cstream.set_priority(0, ec);
+		EXPECT_EQ(errc::invalid_argument, ec);
+		cstream.set_priority(257, ec);
+		EXPECT_EQ(errc::invalid_argument, ec);
+	}
+
+	class HttpPriority : public testing::Test
+	{
+	protected:
+		static constexpr const char* alpn = "\02h3";
+		boost::asio::io_context context;
+		global::context global = global::init_client_server();
+		ssl::context ssl = test::init_server_context(alpn);
+		ssl::context sslc = test::init_client_context(alpn);
+		h3::server server{ context.get_executor() };
+		boost::asio::ip::address localhost = boost::asio::ip::make_address("127.0.0.1");
+		h3::acceptor acceptor{ server, udp::endpoint{ localhost, 0 }, ssl };
+		h3::client client{ context.get_executor(), udp::endpoint{}, sslc };
+		h3::client_connection cconn{ client, acceptor.local_endpoint(), "host" };
+		h3::stream cstream{ cconn };
+
+		void SetUp() override
+		{
+			acceptor.listen(16);
+
+			std::optional<error_code> connect_ec;
+			cconn.async_connect(cstream, capture(connect_ec));
+
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(connect_ec);
+			EXPECT_EQ(ok, *connect_ec);
+		}
+	};
+
+	TEST_F(HttpPriority, not_connected)
+	{
+		auto s = h3::stream{ cconn };
+		error_code ec;
+		s.set_http_priority(h3::priority{}, ec);
+		EXPECT_EQ(errc::not_connected, ec);
+	}
+
+	TEST_F(HttpPriority, set)
+	{
+		cstream.set_http_priority(h3::priority{ 0, true });
+		const auto prio = cstream.http_priority();
+		EXPECT_EQ(0, prio.urgency);
+		EXPECT_TRUE(prio.incremental);
+	}
+
+	TEST_F(HttpPriority, urgency_out_of_range)
+	{
+		error_code ec;
+		cstream.set_http_priority(h3::priority{ 8, false }, ec);
+		EXPECT_EQ(errc::invalid_argument, ec);
+	}
+
+} // namespace nexus
@@ -0,0 +1,138 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+
+	} // anonymous namespace
+
+	class Read : public test::client_server
+	{
+	protected:
+		static constexpr std::string_view message = "hello world";
+
+		void SetUp() override
+		{
+			ASSERT_NO_FATAL_FAILURE(client_server::SetUp());
+
+			std::optional<error_code> stream_accept_ec;
+			sconn.async_accept(sstream, capture(stream_accept_ec));
+
+			std::optional<error_code> write_ec;
+			cstream.async_write_some(boost::asio::buffer(message), capture(write_ec));
+
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(write_ec);
+			EXPECT_EQ(ok, *write_ec);
+			cstream.shutdown(1);
+
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(stream_accept_ec);
+			EXPECT_EQ(ok, *stream_accept_ec);
+		}
+	};
+
+	TEST_F(Read, not_connected)
+	{
+		auto s = quic::stream{ sconn };
+		auto data = std::array<char, 4>{};
+		error_code ec;
+		s.read(boost::asio::buffer(data), ec);
+		EXPECT_EQ(errc::bad_file_descriptor, ec);
+	}
+
+	TEST_F(Read, too_many_buffers)
+	{
+		auto data = std::array<char, 1>{};
+		auto buffers = std::vector<boost::asio::mutable_buffer>(
+			quic::detail::stream_data_operation::max_iovs + 1, boost::asio::buffer(data));
+		std::optional<error_code> read_ec;
+		size_t bytes = 1;
+		sstream.async_read(buffers, capture(read_ec, bytes));
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(errc::invalid_argument, *read_ec);
+		EXPECT_EQ(0, bytes);
+	}
+
+	TEST_F(Read, fill)
+	{
+		auto data = std::array<char, 5>{};
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			ASSERT_EQ(5, bytes);
+			EXPECT_EQ("hello", std::string_view(data.data(), bytes));
+		}
+		{ // the remaining 6 bytes span both buffers
+			auto more = std::array<char, 2>{};
+			auto buffers = std::array{ boost::asio::buffer(data), boost::asio::buffer(more) };
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read(buffers, capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(quic::stream_error::eof, *read_ec);
+			ASSERT_EQ(6, bytes);
+			EXPECT_EQ(" world", std::string_view(data.data(), 5));
+			EXPECT_EQ('d', more[0]);
+		}
+	}
+
+	TEST_F(Read, minimum)
+	{
+		auto data = std::array<char, 64>{};
+		std::optional<error_code> read_ec;
+		size_t bytes = 0;
+		sstream.async_read(boost::asio::buffer(data), 3, capture(read_ec, bytes));
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		ASSERT_LE(3, bytes);
+		EXPECT_EQ(message.substr(0, bytes), std::string_view(data.data(), bytes));
+	}
+
+	TEST_F(Read, from_read_ahead)
+	{
+		sstream.set_read_ahead(4);
+
+		context.poll(); // part of the message waits in the read-ahead buffer
+		ASSERT_FALSE(context.stopped());
+
+		auto data = std::array<char, 11>{};
+		std::optional<error_code> read_ec;
+		size_t bytes = 0;
+		sstream.async_read(boost::asio::buffer(data), capture(read_ec, bytes));
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		ASSERT_EQ(message.size(), bytes);
+		EXPECT_EQ(message, std::string_view(data.data(), bytes));
+	}
+
+} // namespace nexus
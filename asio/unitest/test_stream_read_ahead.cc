@@ -0,0 +1,206 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class ReadAhead : public test::client_server
+	{
+	protected:
+		static constexpr std::string_view message = "hello world";
+
+		void SetUp() override
+		{
+			ASSERT_NO_FATAL_FAILURE(client_server::SetUp());
+
+			std::optional<error_code> stream_accept_ec;
+			sconn.async_accept(sstream, capture(stream_accept_ec));
+
+			std::optional<error_code> write_ec;
+			cstream.async_write_some(boost::asio::buffer(message), capture(write_ec));
+
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(write_ec);
+			EXPECT_EQ(ok, *write_ec);
+			cstream.shutdown(1);
+
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(stream_accept_ec);
+			EXPECT_EQ(ok, *stream_accept_ec);
+		}
+	};
+
+	TEST_F(ReadAhead, not_connected)
+	{
+		auto s = quic::stream{ sconn };
+		error_code ec;
+		s.set_read_ahead(1024, ec);
+		EXPECT_EQ(errc::not_connected, ec);
+	}
+
+	TEST_F(ReadAhead, small_reads)
+	{
+		sstream.set_read_ahead(4096);
+
+		context.poll(); // drain lsquic into the read-ahead buffer
+		ASSERT_FALSE(context.stopped());
+
+		auto data = std::array<char, 5>{};
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			ASSERT_EQ(5, bytes);
+			EXPECT_EQ("hello", std::string_view(data.data(), bytes));
+		}
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			ASSERT_EQ(5, bytes);
+			EXPECT_EQ(" worl", std::string_view(data.data(), bytes));
+		}
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			ASSERT_EQ(1, bytes);
+			EXPECT_EQ("d", std::string_view(data.data(), bytes));
+		}
+		{ // eof
+			std::optional<error_code> read_ec;
+			size_t bytes = 1;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			EXPECT_EQ(0, bytes);
+		}
+	}
+
+	TEST_F(ReadAhead, high_watermark)
+	{
+		// smaller than the message, so draining pauses until a read makes room
+		sstream.set_read_ahead(4);
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+
+		auto received = std::string{};
+		auto data = std::array<char, 3>{};
+		for (int i = 0; i < 16 && received.size() < message.size(); i++)
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			received.append(data.data(), bytes);
+		}
+		EXPECT_EQ(message, received);
+	}
+
+	TEST_F(ReadAhead, shrink_below_buffered)
+	{
+		sstream.set_read_ahead(4096);
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+
+		error_code ec;
+		sstream.set_read_ahead(0, ec);
+		EXPECT_EQ(errc::invalid_argument, ec);
+	}
+
+	// the client writes in two parts, so the buffer refills after reads
+	// have consumed its front
+	class ReadAheadRefill : public test::client_server
+	{
+	};
+
+	TEST_F(ReadAheadRefill, wraps_around)
+	{
+		ASSERT_NO_FATAL_FAILURE(open_stream("hello"));
+		sstream.set_read_ahead(8);
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+
+		auto data = std::array<char, 3>{};
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			context.poll();
+			ASSERT_FALSE(context.stopped());
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			ASSERT_EQ(3, bytes);
+			EXPECT_EQ("hel", std::string_view(data.data(), bytes));
+		}
+
+		// 2 bytes buffered at offset 3. the next 6 only fit once they're moved
+		std::optional<error_code> write_ec;
+		cstream.async_write_some(boost::asio::buffer("world!", 6), capture(write_ec));
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		cstream.shutdown(1);
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+
+		auto received = std::string{};
+		for (int i = 0; i < 16; i++)
+		{
+			std::optional<error_code> read_ec;
+			size_t bytes = 0;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec, bytes));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			EXPECT_EQ(ok, *read_ec);
+			if (bytes == 0)
+			{
+				break; // eof
+			}
+			received.append(data.data(), bytes);
+		}
+		EXPECT_EQ("loworld!", received);
+	}
+
+} // namespace nexus
@@ -0,0 +1,114 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <functional>
+#include <optional>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class Wait : public test::client_server
+	{
+	protected:
+		void SetUp() override
+		{
+			ASSERT_NO_FATAL_FAILURE(client_server::SetUp());
+
+			ASSERT_NO_FATAL_FAILURE(open_stream("x"));
+
+			auto data = std::array<char, 1>{};
+			std::optional<error_code> read_ec;
+			sstream.async_read_some(boost::asio::buffer(data), capture(read_ec));
+			run_until(context, [&]
+			{ return read_ec.has_value(); });
+			ASSERT_TRUE(read_ec);
+			ASSERT_EQ(ok, *read_ec);
+		}
+	};
+
+	TEST_F(Wait, not_connected)
+	{
+		auto s = quic::stream{ cconn };
+		std::optional<error_code> wait_ec;
+		s.async_wait(quic::stream::wait_read, capture(wait_ec));
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(errc::bad_file_descriptor, *wait_ec);
+	}
+
+	TEST_F(Wait, wait_error_unsupported)
+	{
+		std::optional<error_code> wait_ec;
+		sstream.async_wait(boost::asio::socket_base::wait_error, capture(wait_ec));
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(errc::operation_not_supported, *wait_ec);
+	}
+
+	TEST_F(Wait, wait_write)
+	{
+		std::optional<error_code> wait_ec;
+		cstream.async_wait(quic::stream::wait_write, capture(wait_ec));
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+	}
+
+	TEST_F(Wait, wait_read_then_non_blocking_read)
+	{
+		sstream.non_blocking(true);
+		auto data = std::array<char, 16>{};
+		error_code ec;
+		EXPECT_EQ(0, sstream.read_some(boost::asio::buffer(data), ec));
+		EXPECT_EQ(errc::operation_would_block, ec);
+
+		std::optional<error_code> wait_ec;
+		sstream.async_wait(quic::stream::wait_read, capture(wait_ec));
+		context.poll();
+		ASSERT_FALSE(wait_ec);
+
+		cstream.non_blocking(true);
+		const auto message = std::string_view{ "hello" };
+		EXPECT_EQ(message.size(), cstream.write_some(boost::asio::buffer(message), ec));
+		EXPECT_EQ(ok, ec);
+
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+
+		const size_t bytes = sstream.read_some(boost::asio::buffer(data), ec);
+		EXPECT_EQ(ok, ec);
+		EXPECT_EQ(message, std::string_view(data.data(), bytes));
+	}
+
+	TEST_F(Wait, shutdown_cancels_wait)
+	{
+		std::optional<error_code> wait_ec;
+		sstream.async_wait(quic::stream::wait_read, capture(wait_ec));
+		context.poll();
+		ASSERT_FALSE(wait_ec);
+
+		sstream.shutdown(0);
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(quic::stream_error::aborted, *wait_ec);
+	}
+
+} // namespace nexus
@@ -0,0 +1,207 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <unistd.h>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+	} // anonymous namespace
+
+	class WriteAll : public test::client_server
+	{
+	};
+
+	TEST_F(WriteAll, empty)
+	{
+		std::optional<error_code> write_ec;
+		size_t written = 1;
+		cstream.async_write_all(boost::asio::const_buffer{},
+			[&](error_code ec, size_t bytes)
+			{
+				write_ec = ec;
+				written = bytes;
+			});
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		EXPECT_EQ(0, written);
+	}
+
+	TEST_F(WriteAll, buffer_sequence)
+	{
+		// larger than the initial flow control windows, so the write has to
+		// span several on_write() callbacks while the server reads
+		auto head = std::vector<char>(1000, 'a');
+		auto tail = std::vector<char>(256 * 1024, 'b');
+		auto buffers = std::array<boost::asio::const_buffer, 2>{
+			boost::asio::buffer(head), boost::asio::buffer(tail) };
+
+		std::optional<error_code> write_ec;
+		size_t written = 0;
+		cstream.async_write_all(buffers,
+			[&](error_code ec, size_t bytes)
+			{
+				write_ec = ec;
+				written = bytes;
+				cstream.shutdown(1);
+			});
+
+		auto received = std::string{};
+		auto data = std::array<char, 4096>{};
+		std::optional<error_code> read_ec;
+		std::function<void(error_code, size_t)> on_read = [&](error_code ec, size_t bytes)
+		{
+			if (ec || bytes == 0)
+			{
+				read_ec = ec;
+				return;
+			}
+			received.append(data.data(), bytes);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		};
+		sconn.async_accept(sstream, [&](error_code ec)
+		{
+			ASSERT_EQ(ok, ec);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		});
+
+		run_until(context, [&]
+		{ return write_ec && read_ec; });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		EXPECT_EQ(head.size() + tail.size(), written);
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		ASSERT_EQ(head.size() + tail.size(), received.size());
+		EXPECT_EQ(std::string(head.size(), 'a'), received.substr(0, head.size()));
+		EXPECT_EQ(std::string(tail.size(), 'b'), received.substr(head.size()));
+	}
+
+	TEST_F(WriteAll, after_shutdown)
+	{
+		cstream.shutdown(1);
+
+		auto data = std::string_view{ "1234" };
+		std::optional<error_code> write_ec;
+		cstream.async_write_all(boost::asio::buffer(data), capture(write_ec));
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(write_ec);
+		EXPECT_NE(ok, *write_ec);
+	}
+
+	TEST_F(WriteAll, too_many_buffers)
+	{
+		auto data = std::string_view{ "1234" };
+		auto buffers = std::vector<boost::asio::const_buffer>(
+			quic::detail::stream_data_operation::max_iovs + 1, boost::asio::buffer(data));
+		std::optional<error_code> write_ec;
+		size_t written = 1;
+		cstream.async_write_all(buffers, capture(write_ec, written));
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(errc::invalid_argument, *write_ec);
+		EXPECT_EQ(0, written);
+
+		// empty buffers past the limit are nothing to leave out
+		buffers.back() = boost::asio::const_buffer{};
+		write_ec.reset();
+		cstream.async_write_all(buffers, capture(write_ec, written));
+
+		run_until(context, [&]
+		{ return write_ec.has_value(); });
+		ASSERT_TRUE(write_ec);
+		EXPECT_EQ(ok, *write_ec);
+		EXPECT_EQ(quic::detail::stream_data_operation::max_iovs * data.size(), written);
+	}
+
+	TEST_F(WriteAll, send_file)
+	{
+		char path[] = "/tmp/test_send_file.XXXXXX";
+		const int fd = ::mkstemp(path);
+		ASSERT_NE(-1, fd);
+		::unlink(path);
+		auto contents = std::string{};
+		for (int i = 0; i < 100000; i++)
+		{
+			contents.push_back('a' + i % 26);
+		}
+		ASSERT_EQ(static_cast<ssize_t>(contents.size()), ::write(fd, contents.data(), contents.size()));
+
+		// unaligned offset exercises the skew into the first mapped page
+		const off_t offset = 5000;
+		const size_t length = 80000;
+
+		std::optional<error_code> send_ec;
+		size_t sent = 0;
+		cstream.async_send_file(fd, offset, length,
+			[&](error_code ec, size_t bytes)
+			{
+				send_ec = ec;
+				sent = bytes;
+				cstream.shutdown(1);
+			});
+
+		auto received = std::string{};
+		auto data = std::array<char, 4096>{};
+		std::optional<error_code> read_ec;
+		std::function<void(error_code, size_t)> on_read = [&](error_code ec, size_t bytes)
+		{
+			if (ec || bytes == 0)
+			{
+				read_ec = ec;
+				return;
+			}
+			received.append(data.data(), bytes);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		};
+		sconn.async_accept(sstream, [&](error_code ec)
+		{
+			ASSERT_EQ(ok, ec);
+			sstream.async_read_some(boost::asio::buffer(data), on_read);
+		});
+
+		run_until(context, [&]
+		{ return send_ec && read_ec; });
+		::close(fd);
+		ASSERT_TRUE(send_ec);
+		EXPECT_EQ(ok, *send_ec);
+		EXPECT_EQ(length, sent);
+		ASSERT_TRUE(read_ec);
+		EXPECT_EQ(ok, *read_ec);
+		EXPECT_EQ(contents.substr(offset, length), received);
+	}
+
+	TEST_F(WriteAll, send_file_bad_descriptor)
+	{
+		std::optional<error_code> send_ec;
+		cstream.async_send_file(-1, 0, 4096, capture(send_ec));
+
+		context.poll();
+		ASSERT_FALSE(context.stopped());
+		ASSERT_TRUE(send_ec);
+		EXPECT_EQ(errc::bad_file_descriptor, *send_ec);
+	}
+
+} // namespace nexus
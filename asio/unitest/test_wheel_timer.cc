@@ -0,0 +1,119 @@
+#include "quic/quic_server.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <optional>
+#include <vector>
+#include "quic/quic_client.h"
+#include "quic/quic_connection.h"
+#include "quic/quic_stream.h"
+#include "quic/quic_wheel_timer.h"
+#include "global/global_init.h"
+
+#include "test_helpers.h"
+
+namespace nexus
+{
+
+	namespace
+	{
+
+		using test::capture;
+		using test::ok;
+		using test::run_until;
+
+		using std::chrono::steady_clock;
+		using namespace std::chrono_literals;
+
+	} // anonymous namespace
+
+	class WheelTimer : public test::client_server
+	{
+	};
+
+	TEST_F(WheelTimer, expires)
+	{
+		auto timer = quic::wheel_timer{ cconn };
+		const auto start = steady_clock::now();
+		timer.expires_after(20ms);
+		std::optional<error_code> wait_ec;
+		timer.async_wait(capture(wait_ec));
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+		EXPECT_LE(start + 20ms, steady_clock::now());
+	}
+
+	TEST_F(WheelTimer, already_expired)
+	{
+		auto timer = quic::wheel_timer{ cstream };
+		timer.expires_at(steady_clock::now() - 1s);
+		std::optional<error_code> wait_ec;
+		timer.async_wait(capture(wait_ec));
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+	}
+
+	TEST_F(WheelTimer, cancel)
+	{
+		auto timer = quic::wheel_timer{ sconn };
+		timer.expires_after(1h);
+		std::optional<error_code> wait_ec;
+		timer.async_wait(capture(wait_ec));
+		context.poll();
+		EXPECT_FALSE(wait_ec);
+
+		std::optional<error_code> second_ec;
+		timer.async_wait(capture(second_ec));
+		context.poll();
+		ASSERT_TRUE(second_ec);
+		EXPECT_EQ(errc::invalid_argument, *second_ec);
+
+		EXPECT_EQ(1, timer.cancel());
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(errc::operation_canceled, *wait_ec);
+		EXPECT_EQ(0, timer.cancel());
+	}
+
+	TEST_F(WheelTimer, expires_at_cancels)
+	{
+		auto timer = quic::wheel_timer{ cconn };
+		timer.expires_after(1h);
+		std::optional<error_code> wait_ec;
+		timer.async_wait(capture(wait_ec));
+		EXPECT_EQ(1, timer.expires_after(10ms));
+		context.poll();
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(errc::operation_canceled, *wait_ec);
+
+		wait_ec.reset();
+		timer.async_wait(capture(wait_ec));
+		run_until(context, [&]
+		{ return wait_ec.has_value(); });
+		ASSERT_TRUE(wait_ec);
+		EXPECT_EQ(ok, *wait_ec);
+	}
+
+	TEST_F(WheelTimer, many)
+	{
+		constexpr size_t count = 1000;
+		auto timers = std::vector<std::unique_ptr<quic::wheel_timer>>{};
+		size_t expired = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			auto& t = timers.emplace_back(std::make_unique<quic::wheel_timer>(cconn));
+			t->expires_after(std::chrono::milliseconds(i % 100));
+			t->async_wait([&](error_code ec)
+			{
+				EXPECT_EQ(ok, ec);
+				expired++;
+			});
+		}
+		run_until(context, [&]
+		{ return expired == count; });
+		EXPECT_EQ(count, expired);
+	}
+
+} // namespace nexus